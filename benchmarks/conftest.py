@@ -0,0 +1,8 @@
+import pytest
+
+
+@pytest.fixture(scope='session')
+def pypropep():
+    import pypropep
+    pypropep.init()
+    return pypropep
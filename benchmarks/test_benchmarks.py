@@ -0,0 +1,137 @@
+'''
+Benchmarks of the solvers on canonical propellant systems, they need
+pytest-benchmark:
+    py.test benchmarks --benchmark-autosave
+    py.test benchmarks --benchmark-compare
+Every benchmark records the solver iterations and LU solves by solve in
+extra_info and checks them against baseline.jsonl, written by the bench
+program of cpropep (cpropep/src/bench -o baseline.jsonl) which runs the
+same cases.  A change of the solver work fails the benchmark, a change of
+its speed is reported by --benchmark-compare.
+'''
+import os
+import json
+import pytest
+
+pytest.importorskip('pytest_benchmark')
+
+BASELINE = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                        'baseline.jsonl')
+
+# Tolerance of the iterations and LU solves by solve, as in bench.c
+WORK_TOLERANCE = 0.005
+
+LOX_LH2 = [('OXYGEN (LIQUID)', 5.5), ('HYDROGEN (CRYOGENIC)', 1.0)]
+LOX_RP1 = [('OXYGEN (LIQUID)', 2.56), ('RP-1', 1.0)]
+LOX_CH4 = [('OXYGEN (LIQUID)', 3.2), ('METHANE', 1.0)]
+AP_HTPB_AL = [('AMMONIUM PERCHLORATE (AP)', 68.0), ('HTPB (SINCLAIR)', 14.0),
+              ('ALUMINUM (PURE CRYSTALINE)', 18.0)]
+
+EQUILIBRIUM_CASES = [
+    ('tp_lox_lh2', LOX_LH2, dict(P=50., T=3000., type='TP')),
+    ('hp_lox_rp1', LOX_RP1, dict(P=68., type='HP')),
+    ('hp_ap_htpb_al', AP_HTPB_AL, dict(P=68., type='HP')),
+]
+
+PERFORMANCE_CASES = [
+    ('frozen_lox_rp1', 'FrozenPerformance', LOX_RP1, dict(P=68., Pe=1.)),
+    ('shifting_lox_lh2', 'ShiftingPerformance', LOX_LH2,
+     dict(P=50., Ae_At=40.)),
+    ('shifting_ap_htpb_al', 'ShiftingPerformance', AP_HTPB_AL,
+     dict(P=68., Pe=1.)),
+]
+
+
+def _baseline():
+    cases = {}
+    with open(BASELINE) as f:
+        for line in f:
+            if line.strip():
+                record = json.loads(line)
+                cases[record['case']] = record
+    return cases
+
+
+def _mixture(pypropep, mix):
+    return [(pypropep.PROPELLANTS[name], mass) for name, mass in mix]
+
+
+def _check_work(benchmark, name, stats):
+    iterations = sum(s['iterations'] for s in stats)
+    lu = sum(s['lu'] for s in stats)
+    benchmark.extra_info['iterations'] = iterations
+    benchmark.extra_info['lu'] = lu
+
+    base = _baseline().get(name)
+    if base is None:
+        return
+    assert iterations == pytest.approx(base['iterations'],
+                                       rel=WORK_TOLERANCE)
+    assert lu == pytest.approx(base['lu'], rel=WORK_TOLERANCE)
+
+
+def _run(benchmark, setup, solve):
+    # Every round solves a new object, from the same first estimate
+    result = []
+
+    def fresh():
+        return (setup(),), {}
+
+    def once(o):
+        solve(o)
+        result.append(o)
+
+    benchmark.pedantic(once, setup=fresh, rounds=50, warmup_rounds=2)
+    return result[-1]
+
+
+@pytest.mark.parametrize('name,mix,state', EQUILIBRIUM_CASES,
+                         ids=[c[0] for c in EQUILIBRIUM_CASES])
+def test_equilibrium(benchmark, pypropep, name, mix, state):
+    def setup():
+        e = pypropep.Equilibrium()
+        e.add_propellants_by_mass(_mixture(pypropep, mix))
+        return e
+
+    e = _run(benchmark, setup, lambda e: e.set_state(**state))
+    _check_work(benchmark, name, [e.stats])
+
+
+def test_sp_equilibrium(benchmark, pypropep):
+    mix = _mixture(pypropep, LOX_CH4)
+    e = pypropep.Equilibrium()
+    e.add_propellants_by_mass(mix)
+    e.set_state(P=68., type='HP')
+    entropy = pypropep.lib.product_entropy(e._equil)
+
+    def setup():
+        e = pypropep.Equilibrium()
+        e.add_propellants_by_mass(mix)
+        e._equil.entropy = entropy
+        return e
+
+    e = _run(benchmark, setup, lambda e: e.set_state(P=1., type='SP'))
+    _check_work(benchmark, 'sp_lox_ch4', [e.stats])
+
+
+@pytest.mark.parametrize('name,kind,mix,state', PERFORMANCE_CASES,
+                         ids=[c[0] for c in PERFORMANCE_CASES])
+def test_performance(benchmark, pypropep, name, kind, mix, state):
+    def setup():
+        p = getattr(pypropep, kind)()
+        p.add_propellants_by_mass(_mixture(pypropep, mix))
+        return p
+
+    p = _run(benchmark, setup, lambda p: p.set_state(**state))
+    _check_work(benchmark, name, p.stats)
+
+
+def test_of_sweep(benchmark, pypropep):
+    import numpy as np
+    lox = [(pypropep.PROPELLANTS['OXYGEN (LIQUID)'], 1.)]
+    rp1 = [(pypropep.PROPELLANTS['RP-1'], 1.)]
+    OF = np.linspace(2.0, 3.2, 7)
+
+    r = benchmark(pypropep.sweep, rp1, lox, OF=OF, P=68., Pe=1.)
+    benchmark.extra_info['points'] = len(OF)
+    assert np.all(r['Isp'] > 0.)
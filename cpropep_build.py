@@ -29,10 +29,16 @@ for i in inc_dir:
     for f in files:
         inc_files += '#include "%s"\n' % (os.path.basename(f))
 
+# PYPROPEP_TIMELINE=1 compiles the timeline of the solver internals
+macros = [('TIMING', None)]
+if os.environ.get('PYPROPEP_TIMELINE'):
+    macros.append(('TIMELINE', None))
+
 ffibuilder.set_source("pypropep.cpropep._cpropep",
     inc_files,
     sources=src_files,
-    include_dirs=inc_dir)
+    include_dirs=inc_dir,
+    define_macros=macros)
 
 # TODO:Find a way to scrape #defines from headers rather than hard coding const
 ffibuilder.cdef("""
@@ -69,6 +75,8 @@ typedef struct _performance_prop
   double cf;      /* Coefficient of thrust                */
   double Ivac;    /* Specific impulse (vacuum)            */
   double Isp;     /* Specific impulse                     */
+  double residual; /* of the throat or exit iteration     */
+  int    iterations; /* states computed by the iteration */
   ...;
 } performance_prop_t;
 
@@ -129,6 +137,18 @@ typedef struct _equilib_prop
   ...;
 } equilib_prop_t;
 
+typedef struct _solver_stats
+{
+  int    iterations; /* Newton iterations, over all the restarts  */
+  int    restarts;   /* times the iteration counter was reset     */
+  int    lu;         /* LU solves, derivative() included          */
+  int    singular;   /* LU solves on a singular matrix            */
+  int    inserted;   /* condensed species inserted                */
+  int    removed;    /* condensed species removed                 */
+  double lambda;     /* damping factor of the last correction     */
+  double time;       /* wall time (s)                             */
+  unsigned int warnings; /* DIAG_BIT of the diagnostics raised    */
+} solver_stats_t;
 
 typedef struct _new_equilibrium
 {
@@ -144,6 +164,7 @@ typedef struct _new_equilibrium
   product_t          product;
   equilib_prop_t     properties;
   performance_prop_t performance;
+  solver_stats_t     stats;
   ...;
 } equilibrium_t;
 
@@ -194,9 +215,12 @@ extern const char symb[][3];
 
 extern unsigned long num_thermo;
 extern unsigned long num_propellant;
+extern unsigned long database_version;
 
 int thermo_search(char *str);
 int propellant_search(char *str);
+int thermo_name_lookup(char *name, int occurrence);
+int propellant_name_lookup(char *name, int occurrence);
 int atomic_number(char *symbole);
 int propellant_search_by_formula(char *str);
 double enthalpy_0(int sp, float T);
@@ -221,17 +245,234 @@ int reset_element_list(equilibrium_t *e);
 int initialize_equilibrium(equilibrium_t *e);
 int reset_equilibrium(equilibrium_t *e);
 int copy_equilibrium(equilibrium_t *dest, equilibrium_t *src);
+int clear_equilibrium(equilibrium_t *e);
 int compute_thermo_properties(equilibrium_t *e);
 int set_state(equilibrium_t *e, double T, double P);
 int add_in_propellant(equilibrium_t *e, int sp, double mol);
 int equilibrium(equilibrium_t *equil, problem_t P);
 double product_molar_mass(equilibrium_t *e);
+int list_element(equilibrium_t *e);
+int list_product(equilibrium_t *e);
+int product_columns(equilibrium_t *e, int n_species, short *species);
+int product_molar_fractions(equilibrium_t *e, int n_species, short *species,
+                            double *x);
+
+//**** libcpropep/cache.h ****//
+int equilibrium_cache_enable(int size);
+void equilibrium_cache_clear(void);
+void equilibrium_cache_stats(unsigned long *hit, unsigned long *miss);
+int cached_equilibrium(equilibrium_t *e, problem_t P);
+
+//**** libcpropep/diskcache.h ****//
+int disk_cache_open(char *directory);
+void disk_cache_close(void);
+void disk_cache_stats(unsigned long *hit, unsigned long *miss);
+unsigned long database_checksum(void);
+int disk_cached_equilibrium(equilibrium_t *e, problem_t P);
+int disk_cached_frozen_performance(equilibrium_t *e, int n_exit,
+                                   exit_condition_t *exit_type,
+                                   double *value);
+int disk_cached_shifting_performance(equilibrium_t *e, int n_exit,
+                                     exit_condition_t *exit_type,
+                                     double *value);
+
+//**** libcpropep/snapshot.h ****//
+int equilibrium_snapshot_size(equilibrium_t *e);
+int save_equilibrium(equilibrium_t *e, char *buffer, int size);
+int restore_equilibrium(equilibrium_t *e, const char *buffer, int size);
+
+//**** libcpropep/pool.h ****//
+equilibrium_t *equilibrium_pool_get(int n);
+void equilibrium_pool_release(equilibrium_t *e, int n);
+void equilibrium_pool_trim(void);
+void equilibrium_pool_stats(unsigned long *allocated,
+                            unsigned long *recycled,
+                            unsigned long *free_blocks);
+
+//**** libcpropep/timer.h ****//
+typedef enum
+{
+  TIMER_LOAD,
+  TIMER_LIST,
+  TIMER_CHAMBER,
+  TIMER_THROAT,
+  TIMER_EXIT,
+  TIMER_DERIVATIVE,
+  TIMER_LAST,
+  ...
+} timer_phase_t;
+
+typedef struct _timer_stat
+{
+  unsigned long count;   /* number of times the phase was run */
+  double        total;   /* total time (s)                    */
+  double        max;     /* longest run (s)                   */
+  ...;
+} timer_stat_t;
+
+int timer_enabled(void);
+double timer_now(void);
+void timer_add(timer_phase_t phase, double seconds);
+void timer_stats(timer_stat_t *stats);
+void timer_reset(void);
+const char *timer_name(timer_phase_t phase);
+
+//**** libcpropep/trace.h ****//
+int trace_open(const char *filename);
+int trace_close(void);
+void trace_stats(unsigned long *recorded, unsigned long *dropped);
+
+//**** libcpropep/timeline.h ****//
+int timeline_enabled(void);
+int timeline_write(const char *filename);
+void timeline_reset(void);
+void timeline_stats(unsigned long *recorded, unsigned long *dropped);
+
+//**** libcpropep/diag.h ****//
+#define DIAG_BUFFER_SIZE ...
+
+typedef enum
+{
+  DIAG_INFO,
+  DIAG_WARNING,
+  DIAG_ERROR,
+  ...
+} diag_severity_t;
+
+typedef enum
+{
+  DIAG_SINGULAR,
+  DIAG_GAS_REINSERTED,
+  DIAG_NO_CONVERGENCE,
+  DIAG_DERIVATIVE,
+  DIAG_TEMPERATURE,
+  DIAG_THROAT,
+  DIAG_EXIT,
+  DIAG_NO_EQUILIBRIUM,
+  DIAG_MAX_ELEMENT,
+  DIAG_MAX_PRODUCT,
+  DIAG_BUDGET,
+  DIAG_LAST,
+  ...
+} diag_code_t;
+
+typedef struct _diag_message
+{
+  diag_severity_t severity;
+  diag_code_t     code;
+  long            case_id;
+  int             value;
+  ...;
+} diag_message_t;
+
+typedef struct _diag_sink
+{
+  long            case_id;
+  int             limit;
+  FILE           *echo;
+  unsigned long   count[...];
+  int             n_message;
+  diag_message_t  message[...];
+  ...;
+} diag_sink_t;
+
+void diag_init(diag_sink_t *s, int limit, FILE *echo);
+void diag_clear(diag_sink_t *s);
+diag_sink_t *diag_attach(diag_sink_t *s);
+diag_sink_t *diag_attached(void);
+diag_severity_t diag_severity(diag_code_t code);
+const char *diag_severity_name(diag_severity_t severity);
+const char *diag_name(diag_code_t code);
+const char *diag_text(diag_code_t code);
+
+//**** libcpropep/budget.h ****//
+#define ERR_BUDGET ...
+
+typedef struct _solver_budget
+{
+  int    max_iterations;
+  int    max_restarts;
+  double deadline;
+  int    iterations;
+  int    restarts;
+  int    exhausted;
+  ...;
+} solver_budget_t;
+
+void budget_init(solver_budget_t *b, int max_iterations, int max_restarts,
+                 double timeout);
+solver_budget_t *budget_attach(solver_budget_t *b);
+solver_budget_t *budget_attached(void);
+
+//**** libcpropep/sweep.h ****//
+#define SWEEP_STATION_NVAR ...
+#define SWEEP_NVAR ...
+int sweep_columns(equilibrium_t *e, composition_t *fuel,
+                  composition_t *oxidizer);
+int frozen_performance_sweep(equilibrium_t *e, composition_t *fuel,
+                             composition_t *oxidizer, int n, double *of,
+                             double *pc, exit_condition_t exit_type,
+                             double *value, int n_species, short *species,
+                             double *data, int *status);
+int shifting_performance_sweep(equilibrium_t *e, composition_t *fuel,
+                               composition_t *oxidizer, int n, double *of,
+                               double *pc, exit_condition_t exit_type,
+                               double *value, int n_species, short *species,
+                               double *data, int *status);
 
 //**** libcpropep/performance.h ****//
 int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
                        double value);
 int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
                          double value);
+int frozen_performance_multi(equilibrium_t *e, int n_exit,
+                             exit_condition_t *exit_type, double *value);
+int shifting_performance_multi(equilibrium_t *e, int n_exit,
+                               exit_condition_t *exit_type, double *value);
+
+#define NOZZLE_NVAR ...
+
+typedef struct _nozzle_station
+{
+  int    index;  /* Station number, 0 is the chamber   */
+  double ae_at;  /* Station aera / Throat aera         */
+  double T;      /* Temperature (K)                    */
+  double P;      /* Pressure (atm)                     */
+  double rho;    /* Density (kg/m^3)                   */
+  double mach;   /* Mach number                        */
+  double gamma;  /* Isentropic exponent                */
+  double a;      /* Sound speed (m/s)                  */
+  double u;      /* Flow velocity (m/s)                */
+  ...;
+} nozzle_station_t;
+
+typedef int (*nozzle_sink_t)(equilibrium_t *e, nozzle_station_t *s,
+                             void *data);
+
+typedef struct _nozzle_buffer
+{
+  int     size;       /* Number of stations the buffer could hold */
+  int     n;          /* Number of stations written               */
+  int     n_species;  /* Number of composition columns            */
+  short  *species;    /* thermo_list index of each column         */
+  double *data;       /* size * (NOZZLE_NVAR + n_species) doubles */
+  ...;
+} nozzle_buffer_t;
+
+int frozen_nozzle_profile(equilibrium_t *e, int n_station,
+                          exit_condition_t *exit_type, double *value,
+                          nozzle_sink_t sink, void *data);
+int shifting_nozzle_profile(equilibrium_t *e, int n_station,
+                            exit_condition_t *exit_type, double *value,
+                            nozzle_sink_t sink, void *data);
+int nozzle_buffer_sink(equilibrium_t *e, nozzle_station_t *s, void *data);
+int nozzle_buffer_columns(equilibrium_t *e);
+
+int ambient_performance(equilibrium_t *ex, int n, double *pa,
+                        double *cf, double *isp, int *separated);
+int altitude_performance(equilibrium_t *ex, int n, double *altitude,
+                         double *pa, double *cf, double *isp, int *separated);
+double standard_atmosphere_pressure(double altitude);
     """)
 
 if __name__ == "__main__":
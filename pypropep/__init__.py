@@ -6,9 +6,30 @@ from pypropep.propellant import Propellant
 from pypropep.equilibrium import Equilibrium
 from pypropep.performance import RocketPerformance, FrozenPerformance, \
                                  ShiftingPerformance
+from pypropep.cache import enable_cache, disable_cache, clear_cache, \
+                           cache_stats, open_disk_cache, close_disk_cache, \
+                           disk_cache_stats
+from pypropep.sweep import sweep
+from pypropep.parallel import parallel_map, thread_context
+from pypropep.pool import pool_stats, trim_pool
+from pypropep.species import species_names, propellant_names
+from pypropep.table import Table
+from pypropep.timing import TimingStats, timing_stats, reset_timing, \
+                            timing_enabled, timeline_enabled, \
+                            write_timeline, reset_timeline
+from pypropep.trace import start_trace, stop_trace, trace_stats
+from pypropep.diagnostics import Diagnostics, warning_names
+from pypropep.budget import Budget, BudgetExhausted
 
 __all__ = ['Propellant', 'Equilibrium', 'RocketPerformance',
-           'FrozenPerformance', 'ShiftingPerformance', 'init']
+           'FrozenPerformance', 'ShiftingPerformance', 'init',
+           'enable_cache', 'disable_cache', 'clear_cache', 'cache_stats',
+           'open_disk_cache', 'close_disk_cache', 'disk_cache_stats',
+           'sweep', 'parallel_map', 'thread_context', 'pool_stats',
+           'trim_pool', 'TimingStats', 'timing_stats', 'reset_timing',
+           'timing_enabled', 'timeline_enabled', 'write_timeline',
+           'reset_timeline', 'start_trace', 'stop_trace', 'trace_stats',
+           'Diagnostics', 'warning_names', 'Budget', 'BudgetExhausted']
 
 FILE_PATH = os.path.abspath(__file__)
 THERMO_FILE = os.path.dirname(FILE_PATH) + '/data/thermo.dat'
@@ -53,6 +74,7 @@ def init(thermo_file=None, propellant_file=None):
     if propellant_file is not None:
         PROPELLANT_FILE = propellant_file
 
+    start = lib.timer_now()
     r = lib.load_thermo(THERMO_FILE.encode('utf-8'))
     if r > 0:
         print("Loaded {} thermo species".format(r))
@@ -66,35 +88,28 @@ def init(thermo_file=None, propellant_file=None):
     else:
         print("Failed to load propellant file {}".format(PROPELLANT_FILE))
 
-    SPECIES = dict()
-    PROPELLANTS = dict()
-
-    # Build species dict
-    for i in range(lib.num_thermo):
-        s = lib.thermo_list[i]
-        l = len(SPECIES)
-        name = ffi.string(s.name).decode('utf-8')
-        while name in SPECIES:
-            name += "'"
-        SPECIES[name] = AttrDict(convert_to_python(s))
-        SPECIES[name]['id'] = i
-        if len(SPECIES) <= l:
-            raise RuntimeWarning("Species {}, {}:{} dropped".format(i, name,
-                                                            str(SPECIES[name])))
-
-    # Build propellants dict
-    for i in range(lib.num_propellant):
-        p = lib.propellant_list[i]
-        name = ffi.string(p.name).decode('utf-8')
-        l = len(PROPELLANTS)
-        while name in PROPELLANTS:
-            name += "'"
-        PROPELLANTS[name] = Propellant(convert_to_python(p))
-        PROPELLANTS[name]['id'] = i
-        if len(PROPELLANTS) <= l:
-            raise RuntimeWarning("Propellant {}, {}:{} dropped".format(i,
-                                                name, str(PROPELLANTS[name])))
+    if lib.timer_enabled():
+        lib.timer_add(lib.TIMER_LOAD, lib.timer_now() - start)
+
+    # Entries are converted from the C tables when first requested
+    SPECIES = Table(lambda: lib.num_thermo, species_names,
+                    lib.thermo_name_lookup, _species_entry)
+    PROPELLANTS = Table(lambda: lib.num_propellant, propellant_names,
+                        lib.propellant_name_lookup, _propellant_entry)
+
+
+def _species_entry(i):
+    s = AttrDict(convert_to_python(lib.thermo_list[i]))
+    s['id'] = i
+    return s
+
+
+def _propellant_entry(i):
+    p = Propellant(convert_to_python(lib.propellant_list[i]))
+    p['id'] = i
+    return p
+
 
 def find_propellant(substr):
-    return [value for key, value in list(PROPELLANTS.items())
+    return [PROPELLANTS[key] for key in PROPELLANTS
                         if substr.lower() in key.lower()]
@@ -0,0 +1,57 @@
+from .cpropep._cpropep import ffi, lib
+from .error import BudgetExhausted
+
+__all__ = ['Budget', 'BudgetExhausted']
+
+
+class Budget(object):
+    '''
+    Bounds the work of the solvers run by the calling thread:
+
+        with pypropep.Budget(iterations=500, timeout=0.05) as b:
+            p.set_state(P=50., Ae_At=40.)
+
+    iterations is the number of Newton iterations and restarts the number
+    of restarts of the equilibrium iterations, over all the equilibria of
+    the block (chamber, throat and exit stations).  timeout is a deadline
+    in seconds from the creation of the Budget.  None is no limit.
+
+    When a limit is reached the solver stops and set_state raises
+    BudgetExhausted, the properties of the object then hold the state
+    of the last iteration.  The threads started by parallel_map or sweep
+    do not share the budget of the calling thread.
+    '''
+
+    def __init__(self, iterations=None, restarts=None, timeout=None):
+        super(Budget, self).__init__()
+        self._budget = ffi.new("solver_budget_t *")
+        lib.budget_init(self._budget, iterations or 0, restarts or 0,
+                        timeout or 0.0)
+        self._previous = None
+
+    def __enter__(self):
+        self._previous = lib.budget_attach(self._budget)
+        return self
+
+    def __exit__(self, *exc):
+        lib.budget_attach(self._previous)
+        self._previous = None
+        return False
+
+    @property
+    def iterations(self):
+        '''
+        Newton iterations spent.
+        '''
+        return self._budget.iterations
+
+    @property
+    def restarts(self):
+        '''
+        Restarts of the equilibrium iterations spent.
+        '''
+        return self._budget.restarts
+
+    @property
+    def exhausted(self):
+        return bool(self._budget.exhausted)
@@ -0,0 +1,75 @@
+from .cpropep._cpropep import ffi, lib
+from .error import RET_ERRORS
+
+__all__ = ['enable_cache', 'disable_cache', 'clear_cache', 'cache_stats',
+           'open_disk_cache', 'close_disk_cache', 'disk_cache_stats']
+
+
+def enable_cache(size=64):
+    '''
+    Enables the in-process cache of chamber equilibria.  Up to size
+    converged states are kept, the least recently used one is replaced
+    when the cache is full.  Identical (composition, pressure) chambers
+    are then solved only once by FrozenPerformance and
+    ShiftingPerformance.  The cache is emptied when init() reloads the
+    data.
+    '''
+    err = lib.equilibrium_cache_enable(size)
+    if err < 0:
+        raise RuntimeError("Enabling the cache failed with {}".format(
+            RET_ERRORS[err]))
+
+
+def disable_cache():
+    '''
+    Disables the cache and frees its memory.
+    '''
+    lib.equilibrium_cache_enable(0)
+
+
+def clear_cache():
+    '''
+    Removes all the states from the cache, the counters are kept.
+    '''
+    lib.equilibrium_cache_clear()
+
+
+def cache_stats():
+    '''
+    Returns a dict with the number of cache hits and misses.
+    '''
+    hit = ffi.new("unsigned long *")
+    miss = ffi.new("unsigned long *")
+    lib.equilibrium_cache_stats(hit, miss)
+    return {'hits': hit[0], 'misses': miss[0]}
+
+
+def open_disk_cache(directory):
+    '''
+    Keeps the equilibrium and performance results in directory, created
+    if needed, and reuses the results already there.  The directory can
+    be shared with other processes and with the cpropep -c option.
+    Results computed with other thermo or propellant data are not used.
+    '''
+    err = lib.disk_cache_open(directory.encode('utf-8'))
+    if err < 0:
+        raise RuntimeError("Opening the disk cache failed with {}".format(
+            RET_ERRORS[err]))
+
+
+def close_disk_cache():
+    '''
+    Stops using the disk cache, the files are kept.
+    '''
+    lib.disk_cache_close()
+
+
+def disk_cache_stats():
+    '''
+    Returns a dict with the number of results read from the disk cache
+    (hits) and computed (misses).
+    '''
+    hit = ffi.new("unsigned long *")
+    miss = ffi.new("unsigned long *")
+    lib.disk_cache_stats(hit, miss)
+    return {'hits': hit[0], 'misses': miss[0]}
@@ -0,0 +1,782 @@
+/* bench.c  -  Benchmark of the equilibrium and performance solvers    */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef GCC
+#include <unistd.h>
+#else
+#include "getopt.h"
+#endif
+
+#include "num.h"
+
+#include "load.h"
+#include "equilibrium.h"
+#include "performance.h"
+#include "timer.h"
+#include "thermo.h"
+
+#include "print.h"
+
+#include "compat.h"
+#include "return.h"
+
+/* Default number of times each case is solved */
+#define BENCH_REPEAT 100
+
+/* Most ingredients of a case */
+#define BENCH_INGREDIENTS 4
+
+/* Mixture ratios of the sweep cases */
+#define BENCH_SWEEP_POINTS 7
+#define BENCH_SWEEP_FIRST  2.0
+#define BENCH_SWEEP_STEP   0.2
+
+/* A change of the iterations or LU solves by solve larger than this
+   fraction of the baseline is a regression */
+#define BENCH_WORK_TOLERANCE 0.005
+
+/* Calls of NUM_lu timed together, the latency of a call is the
+   mean of its batch */
+#define KERNEL_LU_BATCH 100
+
+typedef enum _bench_kind
+{
+  BENCH_TP,
+  BENCH_HP,
+  BENCH_SP,          /* from the HP state, expanded to value atm */
+  BENCH_FROZEN,
+  BENCH_SHIFTING,
+  BENCH_SWEEP        /* shifting, oxidizer / fuel swept */
+} bench_kind_t;
+
+typedef struct _bench_ingredient
+{
+  char   *name;      /* name in propellant.dat */
+  double  mass;      /* g */
+} bench_ingredient_t;
+
+typedef struct _bench_case
+{
+  char              *name;
+  bench_kind_t       kind;
+  double             P;           /* chamber pressure (atm) */
+  double             T;           /* temperature of TP (K)  */
+  exit_condition_t   exit_type;
+  double             value;       /* exit condition         */
+
+  /* for the sweep, the first ingredient is the oxidizer */
+  bench_ingredient_t ingredient[BENCH_INGREDIENTS];
+} bench_case_t;
+
+/* The canonical propellant systems */
+static bench_case_t bench_case[] = {
+  { "tp_lox_lh2", BENCH_TP, 50.0, 3000.0, PRESSURE, 0.0,
+    { {"OXYGEN (LIQUID)", 5.5}, {"HYDROGEN (CRYOGENIC)", 1.0} } },
+  { "hp_lox_rp1", BENCH_HP, 68.0, 0.0, PRESSURE, 0.0,
+    { {"OXYGEN (LIQUID)", 2.56}, {"RP-1", 1.0} } },
+  { "sp_lox_ch4", BENCH_SP, 68.0, 0.0, PRESSURE, 1.0,
+    { {"OXYGEN (LIQUID)", 3.2}, {"METHANE", 1.0} } },
+  { "frozen_lox_rp1", BENCH_FROZEN, 68.0, 0.0, PRESSURE, 1.0,
+    { {"OXYGEN (LIQUID)", 2.56}, {"RP-1", 1.0} } },
+  { "shifting_lox_lh2", BENCH_SHIFTING, 50.0, 0.0,
+    SUPERSONIC_AREA_RATIO, 40.0,
+    { {"OXYGEN (LIQUID)", 5.5}, {"HYDROGEN (CRYOGENIC)", 1.0} } },
+  { "sweep_lox_rp1", BENCH_SWEEP, 68.0, 0.0, PRESSURE, 1.0,
+    { {"OXYGEN (LIQUID)", 1.0}, {"RP-1", 1.0} } },
+  { "hp_ap_htpb_al", BENCH_HP, 68.0, 0.0, PRESSURE, 0.0,
+    { {"AMMONIUM PERCHLORATE (AP)", 68.0}, {"HTPB (SINCLAIR)", 14.0},
+      {"ALUMINUM (PURE CRYSTALINE)", 18.0} } },
+  { "shifting_ap_htpb_al", BENCH_SHIFTING, 68.0, 0.0, PRESSURE, 1.0,
+    { {"AMMONIUM PERCHLORATE (AP)", 68.0}, {"HTPB (SINCLAIR)", 14.0},
+      {"ALUMINUM (PURE CRYSTALINE)", 18.0} } },
+};
+
+#define BENCH_CASES (int) (sizeof(bench_case) / sizeof(bench_case_t))
+
+typedef enum _kernel_kind
+{
+  KERNEL_LU,               /* the last matrix of the solver on a case */
+  KERNEL_ENTHALPY,         /* each species at the middle of each of  */
+  KERNEL_ENTROPY,          /* its temperature ranges                 */
+  KERNEL_SPECIFIC_HEAT,
+  KERNEL_GIBBS,
+  KERNEL_LIST_PRODUCT      /* the elements of a case */
+} kernel_kind_t;
+
+typedef struct _bench_kernel
+{
+  char          *name;
+  kernel_kind_t  kind;
+  char          *source;   /* case giving the matrix or the elements */
+} bench_kernel_t;
+
+/* The kernels are timed out of the solvers, each one on its own */
+static bench_kernel_t bench_kernel[] = {
+  { "lu_tp_lox_lh2",           KERNEL_LU,            "tp_lox_lh2" },
+  { "lu_hp_lox_rp1",           KERNEL_LU,            "hp_lox_rp1" },
+  { "lu_sp_lox_ch4",           KERNEL_LU,            "sp_lox_ch4" },
+  { "lu_hp_ap_htpb_al",        KERNEL_LU,            "hp_ap_htpb_al" },
+  { "enthalpy_0",              KERNEL_ENTHALPY,      NULL },
+  { "entropy_0",               KERNEL_ENTROPY,       NULL },
+  { "specific_heat_0",         KERNEL_SPECIFIC_HEAT, NULL },
+  { "gibbs",                   KERNEL_GIBBS,         NULL },
+  { "list_product_lox_lh2",    KERNEL_LIST_PRODUCT,  "tp_lox_lh2" },
+  { "list_product_lox_rp1",    KERNEL_LIST_PRODUCT,  "hp_lox_rp1" },
+  { "list_product_ap_htpb_al", KERNEL_LIST_PRODUCT,  "hp_ap_htpb_al" },
+};
+
+#define BENCH_KERNELS (int) (sizeof(bench_kernel) / sizeof(bench_kernel_t))
+
+typedef struct _bench_result
+{
+  int    solves;
+  double solves_per_s;
+  double mean;         /* s */
+  double p99;          /* s */
+  double iterations;   /* Newton iterations by solve */
+  double lu;           /* LU solves by solve         */
+} bench_result_t;
+
+static char data_dir[FILENAME_MAX] = ".";
+
+/* the results of the thermo kernels, so they are not optimized out */
+static volatile double kernel_sink;
+
+
+void usage(void)
+{
+  printf("Usage:");
+  printf("\n\tbench [-n repeat] [-c case] [-s|-k] [-d data_dir]");
+  printf("\n\t      [-o baseline] [-b baseline [-t tolerance]]");
+  printf("\n\nArguments:\n");
+  printf("-n repeat \t Solve each case repeat times (%d)\n", BENCH_REPEAT);
+  printf("-c case \t Run only the named case or kernel\n");
+  printf("-s \t\t Run only the solver cases\n");
+  printf("-k \t\t Run only the kernels\n");
+  printf("-l \t\t List the cases and the kernels\n");
+  printf("-d data_dir \t Directory of thermo.dat and propellant.dat\n");
+  printf("-o baseline \t Write the results as JSON Lines\n");
+  printf("-b baseline \t Compare with a baseline, exit with 1 if the\n"
+         "\t\t iterations or LU solves by solve changed\n");
+  printf("-t tolerance \t Also fail when the mean latency is more than\n"
+         "\t\t tolerance (a fraction) over the baseline\n");
+  printf("-h \t\t Help\n");
+}
+
+/* Fill e with the ingredients of c, the oxidizer mass multiplied by of */
+static int set_composition(equilibrium_t *e, bench_case_t *c, double of)
+{
+  int i, sp;
+
+  e->propellant.ncomp = 0;
+  for (i = 0; (i < BENCH_INGREDIENTS) && (c->ingredient[i].name != NULL); i++)
+  {
+    if ((sp = propellant_name_lookup(c->ingredient[i].name, 0)) < 0)
+    {
+      fprintf(errorfile, "Unknown propellant %s\n", c->ingredient[i].name);
+      return ERROR;
+    }
+    add_in_propellant(e, sp, GRAM_TO_MOL(c->ingredient[i].mass *
+                                         ((i == 0) ? of : 1.0), sp));
+  }
+  return SUCCESS;
+}
+
+/* Fill base with the composition of c and list its elements */
+static int prepare_case(bench_case_t *c, equilibrium_t *base, double of)
+{
+  int err_code;
+
+  initialize_equilibrium(base);
+  if ((err_code = set_composition(base, c, of)) < 0)
+    return err_code;
+  return list_element(base);
+}
+
+/* Entropy of the chamber of a SP case */
+static int case_entropy(bench_case_t *c, equilibrium_t *base,
+                        equilibrium_t *e, double *entropy)
+{
+  int err_code;
+
+  *entropy = 0.0;
+  if (c->kind != BENCH_SP)
+    return SUCCESS;
+
+  copy_equilibrium(e, base);
+  e->properties.P = c->P;
+  if ((err_code = equilibrium(e, HP)) < 0)
+    return err_code;
+  *entropy = product_entropy(e);
+  return SUCCESS;
+}
+
+static bench_case_t *find_case(char *name)
+{
+  int i;
+  for (i = 0; i < BENCH_CASES; i++)
+    if (strcmp(bench_case[i].name, name) == 0)
+      return bench_case + i;
+  return NULL;
+}
+
+/* One solve of the case c from the state base. Only the solver calls
+   are timed, the time is added to *elapsed. */
+static int solve(bench_case_t *c, equilibrium_t *base, equilibrium_t *e,
+                 double entropy, double *elapsed, solver_stats_t *work)
+{
+  int    i, err_code;
+  int    npt = 1;
+  double start;
+
+  copy_equilibrium(e, base);
+  e->product.n[CONDENSED] = 0;
+  e->properties.P = c->P;
+  e->properties.T = c->T;
+
+  start = timer_now();
+  switch (c->kind)
+  {
+    case BENCH_TP:
+        err_code = equilibrium(e, TP);
+        break;
+    case BENCH_HP:
+        err_code = equilibrium(e, HP);
+        break;
+    case BENCH_SP:
+        e->entropy      = entropy;
+        e->properties.P = c->value;
+        err_code = equilibrium(e, SP);
+        break;
+    case BENCH_FROZEN:
+        err_code = frozen_performance(e, c->exit_type, c->value);
+        npt = 3;
+        break;
+    default:
+        err_code = shifting_performance(e, c->exit_type, c->value);
+        npt = 3;
+        break;
+  }
+  *elapsed += timer_now() - start;
+
+  for (i = 0; i < npt; i++)
+    solver_stats_add(work, &(e[i].stats));
+
+  return err_code;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+  double x = *((double *) a);
+  double y = *((double *) b);
+  return (x > y) - (x < y);
+}
+
+static int run_bench(bench_case_t *c, int repeat, equilibrium_t *e,
+                     bench_result_t *r)
+{
+  int    i, j, n, err_code;
+  int    points = (c->kind == BENCH_SWEEP) ? BENCH_SWEEP_POINTS : 1;
+  double entropy = 0.0;
+  double total   = 0.0;
+  double *latency;
+
+  equilibrium_t  *base;
+  solver_stats_t  work;
+
+  if ((base = (equilibrium_t *) malloc(points * sizeof(equilibrium_t)))
+      == NULL)
+    return ERR_MALLOC;
+
+  /* The elements and products are listed out of the timed part, each
+     point of a sweep is solved from the start */
+  for (j = 0; j < points; j++)
+  {
+    if ((err_code = prepare_case(c, base + j, (c->kind == BENCH_SWEEP) ?
+                                 BENCH_SWEEP_FIRST + j*BENCH_SWEEP_STEP :
+                                 1.0)) < 0)
+    {
+      free(base);
+      return err_code;
+    }
+    list_product(base + j);
+  }
+
+  if ((err_code = case_entropy(c, base, e, &entropy)) < 0)
+  {
+    free(base);
+    return err_code;
+  }
+
+  n = repeat * points;
+  if ((latency = (double *) malloc(n * sizeof(double))) == NULL)
+  {
+    free(base);
+    return ERR_MALLOC;
+  }
+
+  memset(&work, 0, sizeof(solver_stats_t));
+  for (i = 0; i < repeat; i++)
+  {
+    for (j = 0; j < points; j++)
+    {
+      latency[i*points + j] = 0.0;
+      if ((err_code = solve(c, base + j, e, entropy,
+                            latency + i*points + j, &work)) < 0)
+      {
+        free(latency);
+        free(base);
+        return err_code;
+      }
+      total += latency[i*points + j];
+    }
+  }
+
+  qsort(latency, n, sizeof(double), compare_double);
+
+  r->solves       = n;
+  r->solves_per_s = n / total;
+  r->mean         = total / n;
+  r->p99          = latency[(int) (0.99 * (n - 1))];
+  r->iterations   = (double) work.iterations / n;
+  r->lu           = (double) work.lu / n;
+
+  free(latency);
+  free(base);
+  return SUCCESS;
+}
+
+/* The matrix of the solver at the solution of the case c, of
+   size rows */
+static int lu_matrix(bench_case_t *c, equilibrium_t *e, double **matrix,
+                     int *size)
+{
+  int            err_code;
+  double         entropy;
+  double         elapsed = 0.0;
+  problem_t      P;
+  equilibrium_t  base;
+  solver_stats_t work;
+
+  memset(&work, 0, sizeof(solver_stats_t));
+  if (((err_code = prepare_case(c, &base, 1.0)) < 0) ||
+      ((err_code = list_product(&base)) < 0) ||
+      ((err_code = case_entropy(c, &base, e, &entropy)) < 0) ||
+      ((err_code = solve(c, &base, e, entropy, &elapsed, &work)) < 0))
+    return err_code;
+
+  if (c->kind == BENCH_TP)
+    P = TP;
+  else if (c->kind == BENCH_SP)
+    P = SP;
+  else
+    P = HP;
+
+  *size = e->product.n_element + e->product.n[CONDENSED] +
+    ((P == TP) ? 1 : 2);
+  if ((*matrix = (double *) malloc(*size * (*size + 1) * sizeof(double)))
+      == NULL)
+    return ERR_MALLOC;
+  fill_equilibrium_matrix(*matrix, e, P);
+  return SUCCESS;
+}
+
+/* Each species at the middle of each of its temperature ranges,
+   return the number of points */
+static int thermo_points(int **sp, float **T)
+{
+  unsigned long i;
+  int           j, n = 0;
+
+  for (i = 0; i < num_thermo; i++)
+    n += thermo_list[i].nint;
+
+  *sp = (int *) malloc(n * sizeof(int));
+  *T  = (float *) malloc(n * sizeof(float));
+  if ((*sp == NULL) || (*T == NULL))
+  {
+    free(*sp);
+    free(*T);
+    return ERR_MALLOC;
+  }
+
+  n = 0;
+  for (i = 0; i < num_thermo; i++)
+  {
+    for (j = 0; j < thermo_list[i].nint; j++)
+    {
+      (*sp)[n] = i;
+      (*T)[n]  = 0.5 * (thermo_list[i].range[j][0] +
+                        thermo_list[i].range[j][1]);
+      n++;
+    }
+  }
+  return n;
+}
+
+/* Time a batch of calls of the thermo kernel of type kind */
+static double thermo_batch(kernel_kind_t kind, int n, int *sp, float *T)
+{
+  int    i;
+  double sum = 0.0;
+  double start;
+
+  start = timer_now();
+  switch (kind)
+  {
+    case KERNEL_ENTHALPY:
+        for (i = 0; i < n; i++)
+          sum += enthalpy_0(sp[i], T[i]);
+        break;
+    case KERNEL_ENTROPY:
+        for (i = 0; i < n; i++)
+          sum += entropy_0(sp[i], T[i]);
+        break;
+    case KERNEL_SPECIFIC_HEAT:
+        for (i = 0; i < n; i++)
+          sum += specific_heat_0(sp[i], T[i]);
+        break;
+    default:
+        for (i = 0; i < n; i++)
+          sum += gibbs(sp[i], thermo_list[sp[i]].state, -1.0, T[i], 1.0);
+        break;
+  }
+  kernel_sink = sum;
+  return timer_now() - start;
+}
+
+static int run_kernel(bench_kernel_t *k, int repeat, equilibrium_t *e,
+                      bench_result_t *r)
+{
+  int    i, j;
+  int    err_code = SUCCESS;
+  int    calls    = 1;
+  int    size     = 0;
+  int    n        = 0;
+  int   *sp       = NULL;
+  float *T        = NULL;
+  double elapsed, start;
+  double total    = 0.0;
+  double *latency;
+  double *matrix  = NULL;
+  double *work    = NULL;
+  double *sol     = NULL;
+
+  bench_case_t  *c = NULL;
+  equilibrium_t  base;
+
+  if (k->source != NULL)
+  {
+    if ((c = find_case(k->source)) == NULL)
+      return ERROR;
+  }
+
+  switch (k->kind)
+  {
+    case KERNEL_LU:
+        if ((err_code = lu_matrix(c, e, &matrix, &size)) < 0)
+          return err_code;
+        work  = (double *) malloc(size * (size + 1) * sizeof(double));
+        sol   = (double *) malloc(size * sizeof(double));
+        calls = KERNEL_LU_BATCH;
+        if ((work == NULL) || (sol == NULL))
+          err_code = ERR_MALLOC;
+        break;
+    case KERNEL_LIST_PRODUCT:
+        err_code = prepare_case(c, &base, 1.0);
+        break;
+    default:
+        if ((calls = thermo_points(&sp, &T)) < 0)
+          return calls;
+        break;
+  }
+
+  if ((err_code < 0) ||
+      ((latency = (double *) malloc(repeat * sizeof(double))) == NULL))
+  {
+    free(matrix);
+    free(work);
+    free(sol);
+    return (err_code < 0) ? err_code : ERR_MALLOC;
+  }
+
+  for (i = 0; i < repeat; i++)
+  {
+    switch (k->kind)
+    {
+      case KERNEL_LU:
+          /* NUM_lu overwrite the matrix, the copy is timed with it */
+          start = timer_now();
+          for (j = 0; j < calls; j++)
+          {
+            memcpy(work, matrix, size * (size + 1) * sizeof(double));
+            NUM_lu(work, sol, size);
+          }
+          elapsed = timer_now() - start;
+          break;
+      case KERNEL_LIST_PRODUCT:
+          copy_equilibrium(e, &base);
+          start = timer_now();
+          list_product(e);
+          elapsed = timer_now() - start;
+          break;
+      default:
+          elapsed = thermo_batch(k->kind, calls, sp, T);
+          break;
+    }
+    latency[i] = elapsed / calls;
+    total     += elapsed;
+    n         += calls;
+  }
+
+  qsort(latency, repeat, sizeof(double), compare_double);
+
+  r->solves       = n;
+  r->solves_per_s = n / total;
+  r->mean         = total / n;
+  r->p99          = latency[(int) (0.99 * (repeat - 1))];
+  r->iterations   = 0.0;
+  r->lu           = 0.0;
+
+  free(latency);
+  free(matrix);
+  free(work);
+  free(sol);
+  free(sp);
+  free(T);
+  return SUCCESS;
+}
+
+static void print_result(char *name, bench_result_t *r)
+{
+  printf("%-24s %8d %10.1f %10.3f %10.3f %9.2f %9.2f\n", name, r->solves,
+         r->solves_per_s, 1e6 * r->mean, 1e6 * r->p99, r->iterations,
+         r->lu);
+}
+
+static void write_result(FILE *fd, char *name, bench_result_t *r)
+{
+  fprintf(fd, "{\"case\": \"%s\", \"solves\": %d, \"solves_per_s\": %.6g, "
+          "\"mean\": %.6g, \"p99\": %.6g, \"iterations\": %.4f, "
+          "\"lu\": %.4f}\n", name, r->solves, r->solves_per_s, r->mean,
+          r->p99, r->iterations, r->lu);
+}
+
+/* Read the record of the case name from a baseline written by -o */
+static int read_baseline(FILE *fd, char *name, bench_result_t *r)
+{
+  char line[512];
+  char record[64];
+
+  rewind(fd);
+  while (fgets(line, sizeof(line), fd) != NULL)
+  {
+    if (sscanf(line, "{\"case\": \"%63[^\"]\", \"solves\": %d, "
+               "\"solves_per_s\": %lf, \"mean\": %lf, \"p99\": %lf, "
+               "\"iterations\": %lf, \"lu\": %lf}", record, &(r->solves),
+               &(r->solves_per_s), &(r->mean), &(r->p99), &(r->iterations),
+               &(r->lu)) != 7)
+      continue;
+    if (strcmp(record, name) == 0)
+      return SUCCESS;
+  }
+  return ERROR;
+}
+
+static int changed(double value, double baseline)
+{
+  return fabs(value - baseline) > BENCH_WORK_TOLERANCE * baseline;
+}
+
+/* Print the differences with the baseline, return the number of
+   regressions */
+static int compare(FILE *fd, char *name, bench_result_t *r,
+                   double tolerance)
+{
+  int            n = 0;
+  bench_result_t b;
+
+  if (read_baseline(fd, name, &b) < 0)
+  {
+    printf("%-24s not in the baseline\n", name);
+    return 0;
+  }
+
+  if (changed(r->iterations, b.iterations))
+  {
+    printf("%-24s iterations by solve %.2f, baseline %.2f\n", name,
+           r->iterations, b.iterations);
+    n++;
+  }
+  if (changed(r->lu, b.lu))
+  {
+    printf("%-24s LU solves by solve %.2f, baseline %.2f\n", name,
+           r->lu, b.lu);
+    n++;
+  }
+  if ((tolerance > 0.0) && (r->mean > (1.0 + tolerance) * b.mean))
+  {
+    printf("%-24s mean latency %.3f us, baseline %.3f us\n", name,
+           1e6 * r->mean, 1e6 * b.mean);
+    n++;
+  }
+  return n;
+}
+
+/* Print, write and compare the result of the case or kernel name,
+   return the number of regressions */
+static int report(char *name, int err_code, bench_result_t *r, FILE *out,
+                  FILE *baseline, double tolerance)
+{
+  if (err_code < 0)
+  {
+    printf("%-24s failed: %s\n", name, err_message[-err_code - 1]);
+    return 1;
+  }
+
+  print_result(name, r);
+  if (out != NULL)
+    write_result(out, name, r);
+  if (baseline != NULL)
+    return compare(baseline, name, r, tolerance);
+  return 0;
+}
+
+int main(int argc, char *argv[])
+{
+  int    i, c;
+  int    err_code;
+  int    repeat     = BENCH_REPEAT;
+  int    regression = 0;
+  double tolerance  = 0.0;
+  int    cases      = true;
+  int    kernels    = true;
+  char  *only       = NULL;
+  char   filename[FILENAME_MAX + 16];
+
+  FILE  *out      = NULL;
+  FILE  *baseline = NULL;
+
+  equilibrium_t  *e;
+  bench_result_t  r;
+
+  errorfile  = stderr;
+  outputfile = stdout;
+
+  while ((c = getopt(argc, argv, "hlskn:c:d:o:b:t:")) != EOF)
+  {
+    switch (c)
+    {
+      case 'n':
+          repeat = atoi(optarg);
+          if (repeat < 1)
+          {
+            printf("Repeat must be at least 1.\n");
+            return ERROR;
+          }
+          break;
+      case 'c':
+          only = optarg;
+          break;
+      case 's':
+          kernels = false;
+          break;
+      case 'k':
+          cases = false;
+          break;
+      case 'l':
+          for (i = 0; i < BENCH_CASES; i++)
+            printf("%s\n", bench_case[i].name);
+          for (i = 0; i < BENCH_KERNELS; i++)
+            printf("%s\n", bench_kernel[i].name);
+          return SUCCESS;
+      case 'd':
+          strncpy(data_dir, optarg, FILENAME_MAX - 1);
+          break;
+      case 'o':
+          if ((out = fopen(optarg, "w")) == NULL)
+          {
+            printf("Unable to open %s\n", optarg);
+            return ERROR;
+          }
+          break;
+      case 'b':
+          if ((baseline = fopen(optarg, "r")) == NULL)
+          {
+            printf("Unable to open %s\n", optarg);
+            return ERROR;
+          }
+          break;
+      case 't':
+          tolerance = atof(optarg);
+          break;
+      case 'h':
+      case '?':
+          usage();
+          return SUCCESS;
+    }
+  }
+
+  /* the output of the loaders is not part of the results */
+  outputfile = stderr;
+  snprintf(filename, sizeof(filename), "%s/thermo.dat", data_dir);
+  if (load_thermo(filename) < 0)
+  {
+    printf("Error loading thermo data file: %s\n", filename);
+    return ERROR;
+  }
+  snprintf(filename, sizeof(filename), "%s/propellant.dat", data_dir);
+  if (load_propellant(filename) < 0)
+  {
+    printf("Error loading propellant file: %s\n", filename);
+    free(thermo_list);
+    return ERROR;
+  }
+  outputfile = stdout;
+
+  if ((e = (equilibrium_t *) malloc(3 * sizeof(equilibrium_t))) == NULL)
+    return ERR_MALLOC;
+
+  printf("%-24s %8s %10s %10s %10s %9s %9s\n", "case", "solves",
+         "solves/s", "mean (us)", "p99 (us)", "iter/sol", "LU/sol");
+
+  for (i = 0; cases && (i < BENCH_CASES); i++)
+  {
+    if ((only != NULL) && (strcmp(only, bench_case[i].name) != 0))
+      continue;
+
+    err_code = run_bench(bench_case + i, repeat, e, &r);
+    regression += report(bench_case[i].name, err_code, &r, out, baseline,
+                         tolerance);
+  }
+
+  for (i = 0; kernels && (i < BENCH_KERNELS); i++)
+  {
+    if ((only != NULL) && (strcmp(only, bench_kernel[i].name) != 0))
+      continue;
+
+    err_code = run_kernel(bench_kernel + i, repeat, e, &r);
+    regression += report(bench_kernel[i].name, err_code, &r, out, baseline,
+                         tolerance);
+  }
+
+  if (out != NULL)
+    fclose(out);
+  if (baseline != NULL)
+  {
+    fclose(baseline);
+    printf("%d regression(s)\n", regression);
+  }
+
+  free(e);
+  free(thermo_list);
+  free(propellant_list);
+
+  return (regression > 0) ? 1 : SUCCESS;
+}
@@ -15,6 +15,11 @@
 
 #ifdef GCC
 #include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #else
 #include "getopt.h"
 #endif
@@ -22,6 +27,14 @@
 #include "load.h"
 #include "equilibrium.h"
 #include "performance.h"
+#include "diskcache.h"
+#include "output.h"
+#include "timer.h"
+#include "trace.h"
+#include "timeline.h"
+#include "diag.h"
+#include "budget.h"
+#include "pool.h"
 #include "derivative.h"
 #include "thermo.h"
 
@@ -34,20 +47,26 @@
 #define version "1.0"
 #define date    "10/07/2000"
 
-//#define CHAMBER_MSG     "Time spent for computing chamber equilibrium"
-//#define FROZEN_MSG      "Time spent for computing frozen performance"
-//#define EQUILIBRIUM_MSG "Time spent for computing equilibrium performance"
-
 #ifndef CONF_FILE
 #define CONF_FILE "cpropep.conf"
 #endif
 
 
-//#undef TIME
-//#define TIME(function, msg) function;
-
 #define MAX_CASE 10
 
+/* Longest line of the input files */
+#define INPUT_LINE 512
+
+/* run_case did not solve a case that miss a variable */
+#define CASE_ABORTED 1
+
+/* Default number of threads of the server */
+#define SERVER_WORKERS 4
+
+/* Diagnostics of each kind printed for a case, the others are
+   counted */
+#define DIAG_CASE_LIMIT 3
+
 typedef enum _p
 {
   SIMPLE_EQUILIBRIUM,
@@ -63,6 +82,18 @@ char case_name[][80] = {
   "Shifting equilibrium performance evaluation"
 };
 
+/* type column of the structured output */
+char case_type[][3] = { "TP", "HP", "FR", "EQ" };
+
+/* format of the results, the structured writers are buffered */
+output_format_t output_fmt = OUTPUT_TEXT;
+output_t        results;
+
+/* work budget of each case (-b), 0 is no limit */
+int    case_iterations = 0;
+int    case_restarts   = 0;
+double case_timeout    = 0.0;   /* s */
+
 char thermo_file[FILENAME_MAX] = "thermo.dat";
 char propellant_file[FILENAME_MAX] = "propellant.dat";
 
@@ -111,14 +142,37 @@ void usage(void)
   */
 
   printf("Usage:");
-  printf("\n\tcpropep -f infile [-voe]");
+  printf("\n\tcpropep -f infile [-voecsmTrb]");
+  printf("\n\tcpropep -s [-voecmTrb] < infile");
+  printf("\n\tcpropep -d socket [-voecwrb]");
   printf("\n\tcpropep -pqtuh");
 
   printf("\n\nArguments:\n");
-  printf("-f file \t Perform an analysis of the propellant data in file\n");
-  printf("-v num  \t Verbosity setting, 0 - 10\n");
+  printf("-f file \t Perform an analysis of the propellant data in file,\n"
+         "        \t standard input if file is -\n");
+  printf("-s      \t Stream the input: solve each case as soon as it is read,\n"
+         "        \t a Propellant section replace the composition, no limit\n"
+         "        \t on the number of cases\n");
+  printf("-v num  \t Verbosity setting, 0 - 10, the iterations of the solvers\n"
+         "        \t are printed by the debug build only (make DEBUG=1)\n");
   printf("-o file \t Results file, stdout if omitted\n");
   printf("-e file \t Error file, stdout if omitted\n");
+  printf("-m fmt  \t Results format: text (default), csv or jsonl\n");
+  printf("-d name \t Serve the requests on the Unix socket name, or on the\n"
+         "        \t standard input and output if name is -. A request is\n"
+         "        \t an input file ended by a line END, it is answered in\n"
+         "        \t JSON Lines\n");
+  printf("-w num  \t Number of threads of the server, %d by default\n",
+         SERVER_WORKERS);
+  printf("-b n,r,ms\t Work budget of each case: n Newton iterations, r\n"
+         "        \t restarts of the iterations and ms milliseconds, r and\n"
+         "        \t ms may be omitted, 0 is no limit\n");
+  printf("-T      \t Print the time spent in each phase on the error file\n");
+  printf("-r file \t Record the requests to the solvers in the trace file,\n"
+         "        \t to be run again by replay\n");
+  printf("-l file \t Write the timeline of the solvers in file (Chrome trace\n"
+         "        \t format), the library must be compiled with TIMELINE\n");
+  printf("-c dir  \t Keep the results in the cache directory dir\n");
   printf("-p      \t Print the propellant list\n");
   printf("-q num  \t Print information about propellant component number num\n");
   printf("-t      \t Print the combustion product list\n");
@@ -128,21 +182,220 @@ void usage(void)
 }
 
 
-int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
-{ 
+/* The parsers below return -1 on an error of the input and write
+   its message in msg, of INPUT_LINE characters. They print nothing:
+   the caller report the error with the case. */
+
+/* Set the kind of the case from the first line of its section,
+   return -1 if it is unknown */
+int parse_case_kind(char *buffer, case_t *t, char *msg)
+{
+  if (strncmp(buffer, "TP", 2) == 0)
+    t->p = SIMPLE_EQUILIBRIUM;
+  else if (strncmp(buffer, "HP", 2) == 0)
+    t->p = FIND_FLAME_TEMPERATURE;
+  else if (strncmp(buffer, "FR", 2) == 0)
+    t->p = FROZEN_PERFORMANCE;
+  else if (strncmp(buffer, "EQ", 2) == 0)
+    t->p = EQUILIBRIUM_PERFORMANCE;
+  else
+  {
+    strcpy(msg, "Unknown option.");
+    return -1;
+  }
+  return 0;
+}
+
+void clear_case(case_t *t)
+{
+  t->p                  = -1;
+  t->temperature_set    = false;
+  t->pressure_set       = false;
+  t->exit_condition_set = false;
+  t->temperature        = 0.0;
+  t->pressure           = 0.0;
+  t->exit_cond_type     = PRESSURE;
+  t->exit_condition     = 0.0;
+}
+
+/* Add the ingredient of a '+' line of the propellant section */
+int parse_propellant(char *buffer, equilibrium_t *e, char *msg)
+{
   double m;
-  
-  int sp;
-  int section = 0;
+  int    sp;
+  char   num[INPUT_LINE], qt[INPUT_LINE], unit[INPUT_LINE];
 
-  int n_case = 0;
-  
-  char buffer[128], num[10], qt[10], unit[10];
-  char variable[64];
+  if (sscanf(buffer, "%s %s %s", num, qt, unit) != 3)
+  {
+    strcpy(msg, "Unit must be g (gram) or m (mol)");
+    return -1;
+  }
+
+  sp = atoi(num + 1);
+  m  = atof(qt);
+
+  if ((sp < 0) || (sp >= num_propellant))
+  {
+    sprintf(msg, "Unknown propellant %d.", sp);
+    return -1;
+  }
+
+  if (e->propellant.ncomp >= MAX_COMP)
+  {
+    sprintf(msg, "Maximum of %d ingredients.", MAX_COMP);
+    return -1;
+  }
+
+  if (strcmp(unit, "g") == 0)
+  {
+    add_in_propellant(e, sp, GRAM_TO_MOL(m, sp) );
+  }
+  else if (strcmp(unit, "m") == 0)
+  {
+    add_in_propellant(e, sp, m);
+  }
+  else
+  {
+    strcpy(msg, "Unit must be g (gram) or m (mol)");
+    return -1;
+  }
+  return 0;
+}
+
+/* Set the variable of a '+' line of a case section */
+int parse_case(char *buffer, case_t *t, char *msg)
+{
+  double m;
+  char   variable[INPUT_LINE], qt[INPUT_LINE], unit[INPUT_LINE];
+  char  *bufptr;
+
+  unit[0] = '\0';
+  sscanf(buffer, "%s %s %s", variable, qt, unit);
+
+  bufptr = variable + 1;
+
+  if (strcmp(bufptr, "chamber_temperature") == 0)
+  {
+    m = atof(qt);
+
+    if (strcmp(unit, "k") == 0)
+    {
+      t->temperature = m;
+    }
+    else if (strcmp(unit, "c") == 0)
+    {
+      t->temperature = m + 273.15;
+    }
+    else if (strcmp(unit, "f") == 0)
+    {
+      t->temperature = (5.0/9.0) * (m - 32.0) + 273.15;
+    }
+    else
+    {
+      strcpy(msg, "Unit must be k (kelvin) or c (celcius)");
+      return -1;
+    }
+
+    t->temperature_set = true;
+  }
+  else if (strcmp(bufptr, "chamber_pressure") == 0)
+  {
+    m = atof(qt);
+
+    if (strcmp(unit, "atm") == 0)
+    {
+      t->pressure = m;
+    }
+    else if (strcmp(unit, "kPa") == 0)
+    {
+      t->pressure = KPA_TO_ATM * m;
+    }
+    else if (strcmp(unit, "psi") == 0)
+    {
+      t->pressure = PSI_TO_ATM * m;
+    }
+    else if (strcmp(unit, "bar") == 0)
+    {
+      t->pressure = BAR_TO_ATM * m;
+    }
+    else
+    {
+      strcpy(msg, "Units must be psi, kPa, atm or bar.");
+      return -1;
+    }
+
+    t->pressure_set = true;
+  }
+  else if (strcmp(bufptr, "exit_pressure") == 0)
+  {
+    m = atof(qt);
+
+    if (strcmp(unit, "atm") == 0)
+    {
+      t->exit_condition = m;
+    }
+    else if (strcmp(unit, "kPa") == 0)
+    {
+      t->exit_condition = KPA_TO_ATM * m;
+    }
+    else if (strcmp(unit, "psi") == 0)
+    {
+      t->exit_condition = PSI_TO_ATM * m;
+    }
+    else if (strcmp(unit, "bar") == 0)
+    {
+      t->exit_condition = BAR_TO_ATM * m;
+    }
+    else
+    {
+      strcpy(msg, "Units must be psi, kPa, atm or bar.");
+      return -1;
+    }
+
+    t->exit_cond_type     = PRESSURE;
+    t->exit_condition_set = true;
+  }
+  else if (strcmp(bufptr, "supersonic_area_ratio") == 0)
+  {
+    t->exit_cond_type     = SUPERSONIC_AREA_RATIO;
+    t->exit_condition     = atof(qt);
+    t->exit_condition_set = true;
+  }
+  else if (strcmp(bufptr, "subsonic_area_ratio") == 0)
+  {
+    t->exit_cond_type     = SUBSONIC_AREA_RATIO;
+    t->exit_condition     = atof(qt);
+    t->exit_condition_set = true;
+  }
+  else
+  {
+    strcpy(msg, "Unknown keyword.");
+    return -1;
+  }
+  return 0;
+}
+
+/* An error of the input read before the cases are solved, printed
+   on the standard output in text mode like the results, and on the
+   error file with a structured writer */
+void print_input_error(output_t *o, const char *msg)
+{
+  if (o == NULL)
+    printf("%s\n", msg);
+  else
+    fprintf(errorfile, "%s\n", msg);
+}
+
+int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe,
+               output_t *o)
+{ 
+  int section = 0;
+  int n_case  = 0;
   
-  char *bufptr;
+  char buffer[INPUT_LINE];
+  char msg[INPUT_LINE];
 
-  while ( fgets(buffer, 128, fd) != NULL )
+  while ( fgets(buffer, INPUT_LINE, fd) != NULL )
   {
     switch (section)
     {
@@ -168,17 +421,9 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
           }
           else
           { 
-            if (strncmp(buffer, "TP", 2) == 0)
-              t[n_case].p = SIMPLE_EQUILIBRIUM;
-            else if (strncmp(buffer, "HP", 2) == 0)
-              t[n_case].p = FIND_FLAME_TEMPERATURE;
-            else if (strncmp(buffer, "FR", 2) == 0)
-              t[n_case].p = FROZEN_PERFORMANCE;
-            else if (strncmp(buffer, "EQ", 2) == 0)
-              t[n_case].p = EQUILIBRIUM_PERFORMANCE;
-            else
+            if (parse_case_kind(buffer, t + n_case, msg) < 0)
             {
-              printf ("Unknown option.\n");
+              print_input_error(o, msg);
               break;
             }
             section = 2;
@@ -189,25 +434,8 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
       case 1:   /* propellant section */
           if (buffer[0] == '+')
           {
-            sscanf(buffer, "%s %s %s", num, qt, unit);
-            bufptr = num + 1;
-            sp = atoi(bufptr);
-            
-            m = atof(qt);
-            
-            if (strcmp(unit, "g") == 0)
-            {
-              add_in_propellant(e, sp, GRAM_TO_MOL(m, sp) );
-            }
-            else if (strcmp(unit, "m") == 0)
-            {
-              add_in_propellant(e, sp, m);
-            }
-            else
-            {
-              printf("Unit must be g (gram) or m (mol)\n");
-              break;
-            }
+            if (parse_propellant(buffer, e, msg) < 0)
+              print_input_error(o, msg);
             break;
           }
           else if (buffer[0] == '#')
@@ -223,114 +451,9 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
       case 2:
           if (buffer[0] == '+')
           {
-            sscanf(buffer, "%s %s %s", variable, qt, unit);
-
-            bufptr = variable + 1;
-
-            if (strcmp(bufptr, "chamber_temperature") == 0)
-            {
-
-              m = atof(qt);
-              
-              if (strcmp(unit, "k") == 0)
-              {
-                t[n_case].temperature = m;
-              }
-              else if (strcmp(unit, "c") == 0)
-              {
-                t[n_case].temperature = m + 273.15;
-              }
-              else if (strcmp(unit, "f") == 0)
-              {
-                t[n_case].temperature = (5.0/9.0) * (m - 32.0) + 273.15;
-              }
-              else
-              {
-                printf("Unit must be k (kelvin) or c (celcius)\n");
-                break;
-              }
-              
-              t[n_case].temperature_set = true;
-
-            }
-            else if (strcmp(bufptr, "chamber_pressure") == 0)
-            {
-              m = atof(qt);
-
-              if (strcmp(unit, "atm") == 0)
-              {
-                t[n_case].pressure = m;
-              }
-              else if (strcmp(unit, "kPa") == 0)
-              {
-                t[n_case].pressure = KPA_TO_ATM * m;
-              }
-              else if (strcmp(unit, "psi") == 0)
-              {
-                t[n_case].pressure = PSI_TO_ATM * m;
-              }
-              else if (strcmp(unit, "bar") == 0)
-              {
-                t[n_case].pressure = BAR_TO_ATM * m;
-              }
-              else
-              {
-                fprintf(errorfile, "Units must be psi, kPa, atm or bar.\n");
-                break;
-              }
-              
-              t[n_case].pressure_set = true;
-            }
-            else if (strcmp(bufptr, "exit_pressure") == 0)
-            {
-              m = atof(qt);
-
-              if (strcmp(unit, "atm") == 0)
-              {
-                t[n_case].exit_condition = m;
-              }
-              else if (strcmp(unit, "kPa") == 0)
-              {
-                t[n_case].exit_condition = KPA_TO_ATM * m;
-              }
-              else if (strcmp(unit, "psi") == 0)
-              {
-                t[n_case].exit_condition = PSI_TO_ATM * m;
-              }
-              else if (strcmp(unit, "bar") == 0)
-              {
-                t[n_case].exit_condition = BAR_TO_ATM * m;
-              }
-              else
-              {
-                fprintf(errorfile, "Units must be psi, kPa, atm or bar.\n");
-                break;
-              }
-              
-              t[n_case].exit_cond_type     = PRESSURE;
-              t[n_case].exit_condition_set = true;
-              
-            }
-            else if (strcmp(bufptr, "supersonic_area_ratio") == 0)
-            {
-              t[n_case].exit_cond_type = SUPERSONIC_AREA_RATIO;
-              t[n_case].exit_condition = atof(qt);
-              t[n_case].exit_condition_set = true;
-            }
-            else if (strcmp(bufptr, "subsonic_area_ratio") == 0)
-            {
-              t[n_case].exit_cond_type = SUBSONIC_AREA_RATIO;
-              t[n_case].exit_condition = atof(qt);
-              t[n_case].exit_condition_set = true;
-            }
-            else
-            {
-              printf("Unknown keyword.\n");
-              break;
-            }
- 
+            if (parse_case(buffer, t + n_case, msg) < 0)
+              print_input_error(o, msg);
             break;
-
           }
           else if (buffer[0] == '#')
           {
@@ -352,6 +475,542 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
   return 0;
 }
 
+/* List the elements and the products of a new composition */
+int prepare_composition(equilibrium_t *e)
+{
+  compute_density(&(e->propellant));
+  list_element(e);
+  return list_product(e);
+}
+
+/* Print the results of the npt stations of e with the structured
+   writer o, or with the text printers if o is NULL */
+void print_results(output_t *o, equilibrium_t *e, short npt, int n_case,
+                   case_t *t)
+{
+  if (o != NULL)
+  {
+    output_record(o, n_case, case_type[t->p], e, npt);
+    return;
+  }
+  print_product_properties(e, npt);
+  if (npt > 1)
+    print_performance_information(e, npt);
+  print_product_composition(e, npt);
+}
+
+/* Print the header of the case number n_case */
+void print_case(output_t *o, int n_case, case_t *t)
+{
+  if (o == NULL)
+    fprintf(outputfile, "Computing case %d\n%s\n\n", n_case,
+            case_name[t->p]);
+}
+
+/* Report why the case number n_case was not solved, as a record of
+   the JSON Lines writer */
+void print_case_error(output_t *o, int n_case, case_t *t, const char *msg)
+{
+  if ((o != NULL) && (o->format == OUTPUT_JSONL))
+    output_error(o, n_case, ((int) t->p < 0) ? "" : case_type[t->p], msg);
+  else
+    fprintf(errorfile, "%s\n", msg);
+}
+
+/* A case that miss a variable is skipped, the message is printed
+   on the standard output in text mode like the results */
+void abort_case(output_t *o, int n_case, case_t *t, const char *msg)
+{
+  if (o == NULL)
+    printf("%s\n", msg);
+  else
+    print_case_error(o, n_case, t, msg);
+}
+
+static int solve_case(output_t *o, equilibrium_t *equil,
+                      equilibrium_t *frozen, equilibrium_t *shifting,
+                      case_t *t, int n_case)
+{
+  int err_code;
+
+  /* be sure to begin iteration without considering
+     condensed species. Once n_condensed have been set */
+  equil->product.n[CONDENSED] = 0;
+  
+  switch (t->p)
+  {
+    case SIMPLE_EQUILIBRIUM:
+
+        if (!(t->temperature_set))
+        {
+          abort_case(o, n_case, t, "Chamber temperature not set. Aborted.");
+          return CASE_ABORTED;
+        }
+        else if (!(t->pressure_set))
+        {
+          abort_case(o, n_case, t, "Chamber pressure not set. Aborted.");
+          return CASE_ABORTED;
+        }
+
+        equil->properties.T = t->temperature;
+        equil->properties.P = t->pressure;
+
+        if (o == NULL)
+          print_propellant_composition(equil);
+        if ((err_code = disk_cached_equilibrium(equil, TP)) < 0)
+          return err_code;
+          
+        print_results(o, equil, 1, n_case, t);
+        break;
+
+    case FIND_FLAME_TEMPERATURE:
+
+        if (!(t->pressure_set))
+        {
+          abort_case(o, n_case, t, "Chamber pressure not set. Aborted.");
+          return CASE_ABORTED;
+        }
+
+        equil->properties.P = t->pressure;
+
+        if (o == NULL)
+          print_propellant_composition(equil);
+        if ((err_code = disk_cached_equilibrium(equil, HP)) < 0)
+          return err_code;
+        
+        print_results(o, equil, 1, n_case, t);
+        break;
+
+    case FROZEN_PERFORMANCE:
+
+        if (!(t->pressure_set))
+        {
+          abort_case(o, n_case, t, "Chamber pressure not set. Aborted.");
+          return CASE_ABORTED;
+        }
+        else if (!(t->exit_condition_set))
+        {
+          abort_case(o, n_case, t, "Exit condition not set. Aborted.");
+          return CASE_ABORTED;
+        }
+
+        equil->properties.T = t->temperature;
+        equil->properties.P = t->pressure;
+        
+        copy_equilibrium(frozen, equil);
+
+        if (o == NULL)
+          print_propellant_composition(frozen);
+
+        if ((err_code = chamber_state(equil, HP)) < 0)
+          return err_code;
+        
+        if ((err_code =
+             disk_cached_frozen_performance(frozen, 1, &(t->exit_cond_type),
+                                            &(t->exit_condition))) < 0)
+          return err_code;
+        
+        print_results(o, frozen, 3, n_case, t);
+        break;
+
+    case EQUILIBRIUM_PERFORMANCE:
+        
+        if (!(t->pressure_set))
+        {
+          abort_case(o, n_case, t, "Chamber pressure not set. Aborted.");
+          return CASE_ABORTED;
+        }
+        else if (!(t->exit_condition_set))
+        {
+          abort_case(o, n_case, t, "Exit condition not set. Aborted.");
+          return CASE_ABORTED;
+        }
+        
+        equil->properties.T = t->temperature;
+        equil->properties.P = t->pressure;
+
+        copy_equilibrium(shifting, equil);
+
+        if (o == NULL)
+          print_propellant_composition(shifting);
+        
+        if ((err_code = disk_cached_equilibrium(shifting, HP)) < 0)
+          return err_code;
+
+        if ((err_code =
+             disk_cached_shifting_performance(shifting, 1,
+                                              &(t->exit_cond_type),
+                                              &(t->exit_condition))) < 0)
+          return err_code;
+
+        print_results(o, shifting, 3, n_case, t);
+        break;
+  }
+  return SUCCESS;
+}
+
+/* Solve one case and print its results, equil hold the composition
+   with its product list, frozen and shifting are the workspaces of
+   the performance cases. Return CASE_ABORTED if a variable of the
+   case is missing. The diagnostics of the case go to the sink of
+   the thread, if there is one, with the number of the case, and
+   the solvers are bounded by the work budget of a case */
+int run_case(output_t *o, equilibrium_t *equil, equilibrium_t *frozen,
+             equilibrium_t *shifting, case_t *t, int n_case)
+{
+  int              err_code;
+  int              bounded;
+  diag_sink_t     *s = diag_attached();
+  solver_budget_t  budget;
+  solver_budget_t *previous = NULL;
+
+  if (s != NULL)
+  {
+    diag_clear(s);
+    s->case_id = n_case;
+  }
+
+  bounded = (case_iterations > 0) || (case_restarts > 0) ||
+    (case_timeout > 0.0);
+  if (bounded)
+  {
+    budget_init(&budget, case_iterations, case_restarts, case_timeout);
+    previous = budget_attach(&budget);
+  }
+
+  err_code = solve_case(o, equil, frozen, shifting, t, n_case);
+
+  if (bounded)
+    budget_attach(previous);
+
+  if ((s != NULL) && (s->echo != NULL))
+    diag_print_suppressed(s->echo, s);
+  return err_code;
+}
+
+/***************************************************************
+FUNCTION: Read the input record by record and solve each case as
+          soon as its section is complete. A new Propellant
+          section replace the composition of the following cases.
+          Only one composition and one case are held in memory, so
+          the input can be of any length.
+
+PARAMETER: o is the structured writer, NULL for the text output.
+           If framed is true, the input end at a line END and the
+           number of cases read is returned in n_read.
+
+COMMENTS: A case that fails is reported and the next one is
+          solved. An error of the input fails the case it belong
+          to, or all the cases of the composition for a propellant
+          line, and is reported like the errors of the solvers.
+          Return the number of cases that failed, or -1
+          if a framed input reach its end of file first.
+****************************************************************/
+int stream_input(FILE *fd, equilibrium_t *equil, equilibrium_t *frozen,
+                 equilibrium_t *shifting, output_t *o, bool framed,
+                 int *n_read)
+{
+  int    err_code;
+  int    n_case   = 0;
+  int    n_failed = 0;
+  int    section  = 0;
+  int    listed   = false;   /* product list of the composition done */
+  int    eof      = false;
+  int    end      = false;
+  char   buffer[INPUT_LINE];
+  char   msg[INPUT_LINE];
+  char   case_error[INPUT_LINE];  /* first error of the case, or ""  */
+  char   comp_error[INPUT_LINE];  /* of the composition              */
+  case_t t;
+
+  initialize_equilibrium(equil);
+  clear_case(&t);
+  case_error[0] = '\0';
+  comp_error[0] = '\0';
+
+  while (!eof && !end)
+  {
+    if (fgets(buffer, INPUT_LINE, fd) == NULL)
+    {
+      eof       = true;
+      buffer[0] = '\0';
+    }
+    else if (framed && (strncmp(buffer, "END", 3) == 0))
+    {
+      end       = true;
+      buffer[0] = '\0';
+    }
+
+    /* comments are allowed in every section */
+    if (buffer[0] == '#')
+      continue;
+
+    if (buffer[0] == '+')
+    {
+      if (section == 1)
+      {
+        if ((parse_propellant(buffer, equil, msg) < 0) &&
+            (comp_error[0] == '\0'))
+          strcpy(comp_error, msg);
+        listed = false;
+      }
+      else if (section == 2)
+      {
+        if ((parse_case(buffer, &t, msg) < 0) && (case_error[0] == '\0'))
+          strcpy(case_error, msg);
+      }
+      continue;
+    }
+
+    /* a blank line, or the end of the input, close the section */
+    if (buffer[0] == ' ' || buffer[0] == '\n' || buffer[0] == '\r' ||
+        buffer[0] == '\0')
+    {
+      if (section == 2)
+      {
+        n_case++;
+
+        if ((case_error[0] == '\0') && (comp_error[0] != '\0'))
+          strcpy(case_error, comp_error);
+
+        if (case_error[0] != '\0')
+        {
+          print_case_error(o, n_case, &t, case_error);
+          err_code = ERROR;
+        }
+        else
+        {
+          print_case(o, n_case, &t);
+
+          if (!listed)
+          {
+            if (equil->propellant.ncomp == 0)
+            {
+              print_case_error(o, n_case, &t,
+                               "Propellant composition not set. Aborted.");
+              err_code = ERROR;
+            }
+            else if ((err_code = prepare_composition(equil)) < 0)
+              print_case_error(o, n_case, &t, err_message[-err_code - 1]);
+            else
+              listed = true;
+          }
+
+          if (listed &&
+              (err_code = run_case(o, equil, frozen, shifting, &t,
+                                   n_case)) < 0)
+            print_case_error(o, n_case, &t, err_message[-err_code - 1]);
+        }
+
+        if (err_code != SUCCESS)
+          n_failed++;
+
+        if (o != NULL)
+        {
+          output_flush(o);
+          fflush(o->fd);
+        }
+        else
+          fflush(outputfile);
+        clear_case(&t);
+        case_error[0] = '\0';
+      }
+      section = 0;
+      continue;
+    }
+
+    if (section != 0)
+      continue;
+
+    if (strncmp(buffer, "Propellant", 10) == 0)
+    {
+      /* a new composition start from an empty product list */
+      initialize_equilibrium(equil);
+      listed        = false;
+      comp_error[0] = '\0';
+      section       = 1;
+    }
+    else
+    {
+      /* an unknown kind still open a case, that fails */
+      if (parse_case_kind(buffer, &t, msg) < 0)
+        strcpy(case_error, msg);
+      section = 2;
+    }
+  }
+
+  if (n_read != NULL)
+    *n_read = n_case;
+
+  if (framed && !end)
+    return -1;
+  return n_failed;
+}
+
+/* The solver buffers of one thread of the server */
+typedef struct _workspace
+{
+  equilibrium_t *equil;
+  equilibrium_t *frozen;
+  equilibrium_t *shifting;
+  output_t       results;
+} workspace_t;
+
+workspace_t *open_workspace(void)
+{
+  workspace_t *w;
+
+  if ((w = (workspace_t *) malloc(sizeof(workspace_t))) == NULL)
+    return NULL;
+
+  w->equil    = equilibrium_pool_get(1);
+  w->frozen   = equilibrium_pool_get(3);
+  w->shifting = equilibrium_pool_get(3);
+
+  if ((w->equil == NULL) || (w->frozen == NULL) || (w->shifting == NULL))
+  {
+    equilibrium_pool_release(w->equil, 1);
+    equilibrium_pool_release(w->frozen, 3);
+    equilibrium_pool_release(w->shifting, 3);
+    free(w);
+    return NULL;
+  }
+  return w;
+}
+
+void close_workspace(workspace_t *w)
+{
+  equilibrium_pool_release(w->equil, 1);
+  equilibrium_pool_release(w->frozen, 3);
+  equilibrium_pool_release(w->shifting, 3);
+  free(w);
+}
+
+/***************************************************************
+FUNCTION: Answer the requests read on in until its end of file.
+
+COMMENTS: A request is an input file (a Propellant section and
+          the cases) ended by a line END. The answer is written
+          on out in JSON Lines, one record per case and station or
+          an error record, ended by the line
+          {"end": true, "cases": n, "failed": n}
+****************************************************************/
+int serve(FILE *in, FILE *out, workspace_t *w)
+{
+  int n_case;
+  int n_failed;
+
+  output_open(&(w->results), out, OUTPUT_JSONL);
+
+  while ((n_failed = stream_input(in, w->equil, w->frozen, w->shifting,
+                                  &(w->results), true, &n_case)) >= 0)
+  {
+    fprintf(out, "{\"end\": true, \"cases\": %d, \"failed\": %d}\n",
+            n_case, n_failed);
+    fflush(out);
+  }
+  return SUCCESS;
+}
+
+#ifdef GCC
+
+static int server_socket = -1;
+
+/* Each thread accept its own connections on the server socket */
+void *server_worker(void *arg)
+{
+  int          s;
+  FILE        *in, *out;
+  workspace_t *w;
+
+  if ((w = open_workspace()) == NULL)
+  {
+    print_error_message(ERR_MALLOC);
+    return NULL;
+  }
+
+  while (1)
+  {
+    if ((s = accept(server_socket, NULL, NULL)) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      break;
+    }
+
+    in  = fdopen(s, "r");
+    out = fdopen(dup(s), "w");
+
+    if ((in != NULL) && (out != NULL))
+      serve(in, out, w);
+
+    if (in != NULL)
+      fclose(in);
+    else
+      close(s);
+    if (out != NULL)
+      fclose(out);
+  }
+
+  close_workspace(w);
+  return NULL;
+}
+
+/***************************************************************
+FUNCTION: Serve the requests of the connections to the Unix
+          socket path with n_worker threads, see serve.
+          Return only on error.
+****************************************************************/
+int start_server(char *path, int n_worker)
+{
+  int                 i;
+  pthread_t           thread;
+  struct sockaddr_un  addr;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    fprintf(errorfile, "Socket name too long: %s\n", path);
+    return ERROR;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  if ((server_socket = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+  {
+    perror("socket");
+    return ERROR;
+  }
+
+  unlink(path);
+  if ((bind(server_socket, (struct sockaddr *) &addr, sizeof(addr)) < 0) ||
+      (listen(server_socket, SOMAXCONN) < 0))
+  {
+    perror(path);
+    close(server_socket);
+    return ERROR;
+  }
+
+  /* a client that leave does not stop the server */
+  signal(SIGPIPE, SIG_IGN);
+
+  for (i = 1; i < n_worker; i++)
+  {
+    if (pthread_create(&thread, NULL, server_worker, NULL) != 0)
+      break;
+    pthread_detach(thread);
+  }
+
+  server_worker(NULL);
+
+  close(server_socket);
+  unlink(path);
+  return ERROR;
+}
+
+#endif
+
 
 int main(int argc, char *argv[])
 {
@@ -369,20 +1028,30 @@ int main(int argc, char *argv[])
 
   double exit_pressure;
 
-//  clock_t timer;
+  int timing = false;
+
+  char *trace_path = NULL;
+  char *timeline_path = NULL;
+  double budget_ms;
+
+  TIMER_VAR(timer)
 
   char variable[64];
   char path[FILENAME_MAX];
   char buffer[512];
 
+  int streaming = false;
+  int status    = 0;
+  int n_worker  = SERVER_WORKERS;
+
+  char        *server_path = NULL;
+  output_t    *o           = NULL;
+  workspace_t *w;
+  diag_sink_t  diag;
+
   case_t case_list[MAX_CASE];
   for (i = 0; i < MAX_CASE; i++)
-  {
-    case_list[i].p = -1;
-    case_list[i].temperature_set = false;
-    case_list[i].pressure_set = false;
-    case_list[i].exit_condition_set = false;
-  }
+    clear_case(case_list + i);
   
   errorfile = stderr;
   outputfile = stdout;
@@ -414,7 +1083,7 @@ int main(int argc, char *argv[])
   
   while (1)
   {
-    c = getopt(argc, argv, "ipht?f:v:o:e:q:u:");
+    c = getopt(argc, argv, "iphstT?f:v:o:e:q:u:c:m:d:w:r:l:b:");
 
     if (c == EOF)
       break;
@@ -449,6 +1118,15 @@ int main(int argc, char *argv[])
           
           break;
 
+          /* the result cache directory */
+      case 'c':
+          if (disk_cache_open(optarg) < 0)
+          {
+            printf("Unable to use the cache directory %s\n", optarg);
+            return (ERROR);
+          }
+          break;
+
           /* print the propellant list */
       case 'p':
           if (!propellant_loaded)
@@ -493,11 +1171,71 @@ int main(int argc, char *argv[])
           }
           strncpy (filename, optarg, FILENAME_MAX);
 
-          if ( (fd = fopen (filename, "r")) == NULL )
+          if (strcmp(filename, "-") == 0)
+            fd = stdin;
+          else if ( (fd = fopen (filename, "r")) == NULL )
             return (ERROR);
           
           break;
 
+          /* the format of the results */
+      case 'm':
+          if ((c = output_format(optarg)) < 0)
+          {
+            printf("Format must be text, csv or jsonl.\n");
+            return (ERROR);
+          }
+          output_fmt = c;
+          break;
+
+          /* serve the requests on a socket, or stdin and stdout */
+      case 'd':
+          server_path = optarg;
+          break;
+
+          /* the number of threads of the server */
+      case 'w':
+          n_worker = atoi(optarg);
+          if (n_worker < 1)
+          {
+            printf("The number of threads must be positive.\n");
+            n_worker = SERVER_WORKERS;
+          }
+          break;
+
+          /* report the time spent in each phase */
+      case 'T':
+          timing = true;
+          break;
+
+          /* work budget of each case */
+      case 'b':
+          budget_ms = 0.0;
+          if ((sscanf(optarg, "%d,%d,%lf", &case_iterations, &case_restarts,
+                      &budget_ms) < 1) || (case_iterations < 0) ||
+              (case_restarts < 0) || (budget_ms < 0.0))
+          {
+            printf("The budget is n,r,ms, numbers not negative.\n");
+            return ERROR;
+          }
+          case_timeout = budget_ms / 1000;
+          break;
+
+          /* record the requests */
+      case 'r':
+          trace_path = optarg;
+          break;
+
+          /* write the timeline of the solvers */
+      case 'l':
+          timeline_path = optarg;
+          break;
+
+          /* solve the cases as they are read */
+      case 's':
+          streaming = true;
+          break;
+
           /* print the thermo list */
       case 't':
           if (!thermo_loaded)
@@ -550,6 +1288,27 @@ int main(int argc, char *argv[])
       
     }
   }  
+
+  /* the output file is known once all the options are read */
+  if (output_fmt != OUTPUT_TEXT)
+  {
+    output_open(&results, outputfile, output_fmt);
+    o = &results;
+  }
+
+  /* the diagnostics of the text output are printed on the error
+     file, the records of the structured ones carry the warnings */
+  if ((o == NULL) && (server_path == NULL))
+  {
+    diag_init(&diag, DIAG_CASE_LIMIT, errorfile);
+    diag_attach(&diag);
+  }
+
+  /* without input file, the stream is read on the standard input */
+  if (streaming && (fd == NULL))
+    fd = stdin;
+
+  TIMER_START(timer);
       
   if (!thermo_loaded)
   {
@@ -571,9 +1330,41 @@ int main(int argc, char *argv[])
     
     propellant_loaded = 1;
   }
+
+  TIMER_STOP(timer, TIMER_LOAD);
+
+  /* the trace refer to the data just loaded */
+  if ((trace_path != NULL) && (trace_open(trace_path) < 0))
+  {
+    printf("Unable to open the trace file %s\n", trace_path);
+    return ERR_FOPEN;
+  }
   
-  
-  if (fd != NULL)
+  if (server_path != NULL)
+  {
+    global_verbose = v;
+
+    if (strcmp(server_path, "-") == 0)
+    {
+      if ((w = open_workspace()) == NULL)
+      {
+        print_error_message(ERR_MALLOC);
+        return ERR_MALLOC;
+      }
+      serve(stdin, outputfile, w);
+      close_workspace(w);
+    }
+    else
+    {
+#ifdef GCC
+      status = start_server(server_path, n_worker);
+#else
+      printf("Only the standard input can be served on this system.\n");
+      status = ERROR;
+#endif
+    }
+  }
+  else if (fd != NULL)
   {
     equil = (equilibrium_t *) malloc (sizeof (equilibrium_t));
     initialize_equilibrium(equil);
@@ -586,169 +1377,68 @@ int main(int argc, char *argv[])
       initialize_equilibrium(frozen + i);
       initialize_equilibrium(shifting + i);
     }
-    
-    load_input(fd, equil, case_list, &exit_pressure);
-    
-    compute_density(&(equil->propellant));
-    
-    fclose(fd);
+
     global_verbose = v;
 
-    list_element(equil);
-    if ((err_code = list_product(equil)) < 0)
+    if (streaming)
     {
-      print_error_message(err_code);
-      return err_code;
+      if (stream_input(fd, equil, frozen, shifting, o, false, NULL) > 0)
+        status = ERROR;
     }
-    
-    i = 0;
-    while ((case_list[i].p != -1) && (i <= MAX_CASE))
+    else
     {
-      fprintf(outputfile, "Computing case %d\n%s\n\n", i+1,
-              case_name[case_list[i].p]);
+      load_input(fd, equil, case_list, &exit_pressure, o);
 
-      /* be sure to begin iteration without considering
-         condensed species. Once n_condensed have been set */
-      equil->product.n[CONDENSED] = 0;
-        
-      switch (case_list[i].p)
+      if ((err_code = prepare_composition(equil)) < 0)
       {
-        case SIMPLE_EQUILIBRIUM:
-
-            if (!(case_list[i].temperature_set))
-            {
-              printf("Chamber temperature not set. Aborted.\n");
-              break;
-            }
-            else if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-
-            equil->properties.T = case_list[i].temperature;
-            equil->properties.P = case_list[i].pressure;
-            
-            print_propellant_composition(equil);
-            if ((err_code = equilibrium(equil, TP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-              
-            print_product_properties(equil, 1);
-            print_product_composition(equil, 1);
-            break;
-
-        case FIND_FLAME_TEMPERATURE:
-
-            if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-
-            equil->properties.P = case_list[i].pressure;
-                        
-            print_propellant_composition(equil);
-            if ((err_code = equilibrium(equil, HP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-            
-            print_product_properties(equil, 1);
-            print_product_composition(equil, 1);
-            break;
-
-        case FROZEN_PERFORMANCE:
-
-            if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-            else if (!(case_list[i].exit_condition_set))
-            {
-              printf("Exit condition not set. Aborted.\n");
-              break;
-            }
-
-            equil->properties.T = case_list[i].temperature;
-            equil->properties.P = case_list[i].pressure;
-            
-            copy_equilibrium(frozen, equil);
-            
-            print_propellant_composition(frozen);
-
-            if ((err_code = equilibrium(equil, HP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-            
-            if ((err_code =
-                 frozen_performance(frozen, case_list[i].exit_cond_type,
-                                    case_list[i].exit_condition)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-            
-            print_product_properties(frozen, 3);
-            print_performance_information(frozen, 3);
-            print_product_composition(frozen, 3);
-            
-          break;
-        case EQUILIBRIUM_PERFORMANCE:
-
-            
-            if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-            else if (!(case_list[i].exit_condition_set))
-            {
-              printf("Exit condition not set. Aborted.\n");
-              break;
-            }
-            
-            equil->properties.T = case_list[i].temperature;
-            equil->properties.P = case_list[i].pressure;
+        print_error_message(err_code);
+        return err_code;
+      }
+    
+      i = 0;
+      while ((i < MAX_CASE) && (case_list[i].p != -1))
+      {
+        print_case(o, i + 1, case_list + i);
+
+        if ((err_code = run_case(o, equil, frozen, shifting,
+                                 case_list + i, i + 1)) < 0)
+        {
+          if (o != NULL)
+            output_flush(o);
+          print_error_message(err_code);
+          return err_code;
+        }
+        i++;
+      }
+    }
 
-            copy_equilibrium(shifting, equil);
-            
-            print_propellant_composition(shifting);
-            
-            if ((err_code = equilibrium(shifting, HP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
+    if (fd != stdin)
+      fclose(fd);
 
-            if ((err_code = shifting_performance(shifting,
-                                                 case_list[i].exit_cond_type,
-                                                 case_list[i].exit_condition))
-                < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
+    if (o != NULL)
+      output_flush(o);
 
-            print_product_properties(shifting, 3);
-            print_performance_information(shifting, 3);
-            print_product_composition(shifting, 3);
-            
-            break;
-      }
-      i++;
-    }
     free (equil);
     free (frozen);
     free (shifting);
     
   }
+
+  if (timing)
+    timer_report(errorfile);
+
+  if (trace_path != NULL)
+    trace_close();
+
+  if (timeline_path != NULL)
+  {
+    if (!timeline_enabled())
+      fprintf(errorfile, "The library is compiled without TIMELINE, "
+              "the timeline is empty.\n");
+    if (timeline_write(timeline_path) < 0)
+      fprintf(errorfile, "Unable to write the timeline file %s\n",
+              timeline_path);
+  }
   
   free (propellant_list);
   free (thermo_list);
@@ -759,6 +1449,6 @@ int main(int argc, char *argv[])
   if (outputfile != stdout)
     fclose (outputfile);
   
-  return 0;
+  return status;
 
 }
@@ -0,0 +1,350 @@
+/* replay.c  -  Run again the requests recorded in a trace             */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GCC
+#include <unistd.h>
+#include <pthread.h>
+#else
+#include "getopt.h"
+#endif
+
+#include "load.h"
+#include "equilibrium.h"
+#include "performance.h"
+#include "diskcache.h"
+#include "timer.h"
+#include "trace.h"
+#include "thermo.h"
+
+#include "print.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+#define REPLAY_THREADS_MAX 64
+
+typedef struct _replay
+{
+  trace_request_t *request;
+  int              n_request;
+  int              n_run;       /* n_request times the repeat */
+  int              n_state;     /* equilibrium_t needed by a request */
+
+  double          *latency;     /* of each run (s) */
+  int             *status;
+
+  int              next;        /* next run to solve */
+} replay_t;
+
+static char data_dir[FILENAME_MAX] = ".";
+
+/* taken by the threads to get their next run */
+static mutex_t replay_lock = MUTEX_INITIALIZER;
+
+
+void usage(void)
+{
+  printf("Usage:");
+  printf("\n\treplay [-j threads] [-n repeat] [-d data_dir] trace");
+  printf("\n\nArguments:\n");
+  printf("-j threads \t Solve the requests with threads threads (1)\n");
+  printf("-n repeat \t Run the trace repeat times (1)\n");
+  printf("-d data_dir \t Directory of thermo.dat and propellant.dat\n");
+  printf("-h \t\t Help\n");
+  printf("\nThe trace is recorded with cpropep -r or pypropep.start_trace\n");
+}
+
+static int load_trace(char *filename, replay_t *r)
+{
+  int             err_code;
+  int             size = 256;
+  unsigned long   checksum;
+  FILE           *fd;
+
+  if ((fd = fopen(filename, "rb")) == NULL)
+  {
+    printf("Unable to open %s\n", filename);
+    return ERR_FOPEN;
+  }
+
+  if (trace_read_header(fd, &checksum) < 0)
+  {
+    printf("%s is not a trace.\n", filename);
+    fclose(fd);
+    return ERROR;
+  }
+  if (checksum != database_checksum())
+    printf("Warning: the trace was recorded with other thermo or "
+           "propellant data.\n");
+
+  r->n_request = 0;
+  r->n_state   = 1;
+  r->request   = (trace_request_t *) malloc(size * sizeof(trace_request_t));
+
+  while (r->request != NULL)
+  {
+    if (r->n_request == size)
+    {
+      size *= 2;
+      r->request = (trace_request_t *)
+        realloc(r->request, size * sizeof(trace_request_t));
+      if (r->request == NULL)
+        break;
+    }
+
+    if ((err_code = trace_read(fd, r->request + r->n_request)) < 0)
+    {
+      if (err_code != ERR_EOF)
+        printf("Warning: the trace is truncated after %d requests.\n",
+               r->n_request);
+      break;
+    }
+
+    if (r->request[r->n_request].kind != TRACE_EQUILIBRIUM)
+      r->n_state = __max(r->n_state, 2 + r->request[r->n_request].n_exit);
+    r->n_request++;
+  }
+  fclose(fd);
+
+  if (r->request == NULL)
+    return ERR_MALLOC;
+  return SUCCESS;
+}
+
+/* Solve the request q from the first estimate, only the solver call
+   is timed */
+static int replay_request(trace_request_t *q, equilibrium_t *e,
+                          double *elapsed)
+{
+  int    i, err_code;
+  double start;
+
+  memset(e, 0, sizeof(equilibrium_t));
+  initialize_equilibrium(e);
+  for (i = 0; i < q->propellant.ncomp; i++)
+  {
+    if ((q->propellant.molecule[i] < 0) ||
+        (q->propellant.molecule[i] >= (long) num_propellant))
+      return ERROR;
+    add_in_propellant(e, q->propellant.molecule[i], q->propellant.coef[i]);
+  }
+  list_element(e);
+  if ((err_code = list_product(e)) < 0)
+    return err_code;
+
+  e->properties.P = q->P;
+  e->properties.T = q->T;
+  e->entropy      = q->entropy;
+
+  start = timer_now();
+  switch (q->kind)
+  {
+    case TRACE_EQUILIBRIUM:
+        err_code = equilibrium(e, q->problem);
+        break;
+    case TRACE_FROZEN:
+        err_code = frozen_performance_multi(e, q->n_exit, q->exit_type,
+                                            q->value);
+        break;
+    default:
+        err_code = shifting_performance_multi(e, q->n_exit, q->exit_type,
+                                              q->value);
+        break;
+  }
+  *elapsed = timer_now() - start;
+  return err_code;
+}
+
+/* Solve the runs taken one by one from r until there is no more */
+static void *worker(void *arg)
+{
+  int            i;
+  replay_t      *r = (replay_t *) arg;
+  equilibrium_t *e;
+
+  if ((e = (equilibrium_t *) malloc(r->n_state * sizeof(equilibrium_t)))
+      == NULL)
+    return NULL;
+
+  while (1)
+  {
+    mutex_lock(&replay_lock);
+    i = r->next++;
+    mutex_unlock(&replay_lock);
+
+    if (i >= r->n_run)
+      break;
+
+    r->status[i] = replay_request(r->request + (i % r->n_request), e,
+                                  r->latency + i);
+  }
+
+  free(e);
+  return NULL;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+  double x = *((double *) a);
+  double y = *((double *) b);
+  return (x > y) - (x < y);
+}
+
+/* Latency distribution of the runs of kind (TRACE_LAST for all) */
+static void report(replay_t *r, trace_kind_t kind, double *sorted)
+{
+  int    i, n = 0, failed = 0;
+  double total = 0.0;
+
+  for (i = 0; i < r->n_run; i++)
+  {
+    if ((kind != TRACE_LAST) &&
+        (r->request[i % r->n_request].kind != kind))
+      continue;
+    if (r->status[i] < 0)
+      failed++;
+    sorted[n++] = r->latency[i];
+    total      += r->latency[i];
+  }
+  if (n == 0)
+    return;
+
+  qsort(sorted, n, sizeof(double), compare_double);
+
+  printf("%-12s %8d %7d %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+         (kind == TRACE_LAST) ? "all" : trace_kind_name(kind), n, failed,
+         1e6 * total / n, 1e6 * sorted[(n - 1) / 2],
+         1e6 * sorted[(int) (0.9 * (n - 1))],
+         1e6 * sorted[(int) (0.99 * (n - 1))], 1e6 * sorted[n - 1]);
+}
+
+int main(int argc, char *argv[])
+{
+  int    i, c;
+  int    n_thread = 1;
+  int    repeat   = 1;
+  double start, wall;
+  double *sorted;
+  char   filename[FILENAME_MAX + 16];
+
+  replay_t r;
+
+#ifdef GCC
+  pthread_t thread[REPLAY_THREADS_MAX];
+#endif
+
+  errorfile  = stderr;
+  outputfile = stderr;
+
+  while ((c = getopt(argc, argv, "hj:n:d:")) != EOF)
+  {
+    switch (c)
+    {
+      case 'j':
+          n_thread = atoi(optarg);
+          if ((n_thread < 1) || (n_thread > REPLAY_THREADS_MAX))
+          {
+            printf("The number of threads must be between 1 and %d.\n",
+                   REPLAY_THREADS_MAX);
+            return ERROR;
+          }
+          break;
+      case 'n':
+          repeat = atoi(optarg);
+          if (repeat < 1)
+          {
+            printf("Repeat must be at least 1.\n");
+            return ERROR;
+          }
+          break;
+      case 'd':
+          strncpy(data_dir, optarg, FILENAME_MAX - 1);
+          break;
+      case 'h':
+      case '?':
+          usage();
+          return SUCCESS;
+    }
+  }
+
+  if (optind >= argc)
+  {
+    usage();
+    return ERROR;
+  }
+
+#ifndef GCC
+  if (n_thread > 1)
+  {
+    printf("Only one thread on this system.\n");
+    n_thread = 1;
+  }
+#endif
+
+  snprintf(filename, sizeof(filename), "%s/thermo.dat", data_dir);
+  if (load_thermo(filename) < 0)
+  {
+    printf("Error loading thermo data file: %s\n", filename);
+    return ERROR;
+  }
+  snprintf(filename, sizeof(filename), "%s/propellant.dat", data_dir);
+  if (load_propellant(filename) < 0)
+  {
+    printf("Error loading propellant file: %s\n", filename);
+    free(thermo_list);
+    return ERROR;
+  }
+
+  if (load_trace(argv[optind], &r) < 0)
+    return ERROR;
+
+  if (r.n_request == 0)
+  {
+    printf("The trace is empty.\n");
+    free(r.request);
+    return SUCCESS;
+  }
+
+  r.n_run   = r.n_request * repeat;
+  r.next    = 0;
+  r.latency = (double *) calloc(r.n_run, sizeof(double));
+  r.status  = (int *) calloc(r.n_run, sizeof(int));
+  sorted    = (double *) malloc(r.n_run * sizeof(double));
+
+  if ((r.latency == NULL) || (r.status == NULL) || (sorted == NULL))
+    return ERR_MALLOC;
+
+  start = timer_now();
+#ifdef GCC
+  for (i = 0; i < n_thread; i++)
+    pthread_create(thread + i, NULL, worker, &r);
+  for (i = 0; i < n_thread; i++)
+    pthread_join(thread[i], NULL);
+#else
+  worker(&r);
+#endif
+  wall = timer_now() - start;
+
+  printf("%d requests, %d threads, %.3f s, %.1f requests/s\n\n",
+         r.n_run, n_thread, wall, r.n_run / wall);
+  printf("%-12s %8s %7s %10s %10s %10s %10s %10s\n", "request", "count",
+         "failed", "mean (us)", "p50 (us)", "p90 (us)", "p99 (us)",
+         "max (us)");
+  for (i = 0; i < TRACE_LAST; i++)
+    report(&r, i, sorted);
+  report(&r, TRACE_LAST, sorted);
+
+  free(sorted);
+  free(r.latency);
+  free(r.status);
+  free(r.request);
+  free(thermo_list);
+  free(propellant_list);
+  return SUCCESS;
+}
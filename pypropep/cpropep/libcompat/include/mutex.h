@@ -0,0 +1,69 @@
+#ifndef MUTEX_H
+#define MUTEX_H
+
+/*
+  Mutual exclusion of the data shared between the threads calling
+  the library at the same time (the caches and the name index).
+  A mutex is statically initialized with MUTEX_INITIALIZER.
+  A thread wait with cond_wait, holding the mutex m, until another
+  one call cond_broadcast; the condition must be checked again.
+  The destructor f given to thread_key_create is called at the exit
+  of each thread that set a value of the key, with this value. Only
+  with pthreads: elsewhere the values are never released.
+  A static variable declared THREAD_LOCAL has a copy in each thread.
+*/
+
+#if defined(_MSC_VER) || defined(BORLAND)
+
+#include <windows.h>
+
+typedef volatile LONG mutex_t;
+
+#define MUTEX_INITIALIZER 0
+#define mutex_lock(m)     while (InterlockedExchange((m), 1)) Sleep(0)
+#define mutex_unlock(m)   InterlockedExchange((m), 0)
+
+/* the lock spin, a wait only yield */
+typedef int cond_t;
+
+#define COND_INITIALIZER  0
+#define cond_wait(c, m)   (mutex_unlock(m), Sleep(0), mutex_lock(m))
+#define cond_broadcast(c) ((void) 0)
+
+typedef int thread_key_t;
+
+#define thread_key_create(k, f) (*(k) = 0)
+#define thread_key_set(k, v)    ((void) 0)
+
+#ifdef BORLAND
+#define THREAD_LOCAL      __thread
+#else
+#define THREAD_LOCAL      __declspec(thread)
+#endif
+
+#else
+
+#include <pthread.h>
+
+typedef pthread_mutex_t mutex_t;
+
+#define MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define mutex_lock(m)     pthread_mutex_lock(m)
+#define mutex_unlock(m)   pthread_mutex_unlock(m)
+
+typedef pthread_cond_t cond_t;
+
+#define COND_INITIALIZER  PTHREAD_COND_INITIALIZER
+#define cond_wait(c, m)   pthread_cond_wait((c), (m))
+#define cond_broadcast(c) pthread_cond_broadcast(c)
+
+typedef pthread_key_t thread_key_t;
+
+#define thread_key_create(k, f) pthread_key_create((k), (f))
+#define thread_key_set(k, v)    pthread_setspecific((k), (v))
+
+#define THREAD_LOCAL      __thread
+
+#endif
+
+#endif	/* !defined(MUTEX_H) */
@@ -0,0 +1,54 @@
+#ifndef budget_h
+#define budget_h
+
+/* Work allowed to the solvers of a thread, shared by all the
+   equilibrium() of a request: the chamber, the throat and the exit
+   iterations. A limit of 0 is no limit. */
+typedef struct _solver_budget
+{
+  int    max_iterations;  /* Newton iterations                    */
+  int    max_restarts;    /* resets of the iteration counter      */
+  double deadline;        /* timer_now() date, 0.0 for none       */
+
+  int    iterations;      /* spent since budget_init()            */
+  int    restarts;
+  int    exhausted;       /* true once a limit is reached         */
+} solver_budget_t;
+
+/***************************************************************
+FUNCTION: Initialize b with its limits, the deadline is timeout
+          seconds from now (no deadline if timeout <= 0).
+****************************************************************/
+void budget_init(solver_budget_t *b, int max_iterations, int max_restarts,
+                 double timeout);
+
+/***************************************************************
+FUNCTION: Attach b to the calling thread, the solvers run by this
+          thread spend it. Return the budget attached before, to
+          be attached again when done. NULL remove the limits.
+
+COMMENTS: The threads of a pool or a sweep do not see the budget
+          of the thread that started them.
+****************************************************************/
+solver_budget_t *budget_attach(solver_budget_t *b);
+
+/* Budget attached to the calling thread, NULL if none */
+solver_budget_t *budget_attached(void);
+
+/***************************************************************
+FUNCTION: Spend one Newton iteration (one restart) of the budget
+          of the thread. Return true if the budget is exhausted,
+          the solver must then stop and return ERR_BUDGET with
+          the state of its last iteration.
+
+COMMENTS: Only test a pointer when no budget is attached, the
+          clock is read only if there is a deadline.
+****************************************************************/
+int budget_iteration(void);
+int budget_restart(void);
+
+/* Return true if the budget of the thread is exhausted, the
+   deadline included */
+int budget_exhausted(void);
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef cache_h
+#define cache_h
+
+#include "equilibrium.h"
+
+/***************************************************************
+FUNCTION: Enable the cache of converged equilibria with room for
+          size states. The least recently used state is replaced
+          when the cache is full. A size of 0 disable the cache
+          and free its memory.
+
+COMMENTS: The cache is disabled by default.
+****************************************************************/
+int equilibrium_cache_enable(int size);
+
+/* Remove all the states from the cache, the counters are kept */
+void equilibrium_cache_clear(void);
+
+/* Number of lookups found in the cache and computed */
+void equilibrium_cache_stats(unsigned long *hit, unsigned long *miss);
+
+/***************************************************************
+FUNCTION: Same as equilibrium() but look first in the cache for a
+          state with the same composition, problem type and
+          targets (pressure, and temperature for TP or entropy
+          for SP).
+
+PARAMETER: e and P as for equilibrium()
+
+COMMENTS: The composition is compare after sorting the ingredients
+          and normalizing their amounts, so the same mixture given
+          in another order or scale share its entry. The cache is
+          emptied when the thermo or propellant data are reloaded.
+          The lookup and the replacement take a constant time, the
+          states are copied without holding the lock of the cache.
+****************************************************************/
+int cached_equilibrium(equilibrium_t *e, problem_t P);
+
+/***************************************************************
+FUNCTION: Write in dest the ingredients of src sorted by molecule
+          number, with the same molecule merged and the amounts
+          normalized to a sum of 1.
+
+COMMENTS: Two mixtures that give the same equilibrium have the
+          same canonical composition.
+****************************************************************/
+int canonical_composition(composition_t *src, composition_t *dest);
+
+#endif
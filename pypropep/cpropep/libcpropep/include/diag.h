@@ -0,0 +1,104 @@
+#ifndef diag_h
+#define diag_h
+
+#include <stdio.h>
+
+#include "type.h"
+
+/* Messages kept by a sink, the following ones are only counted */
+#define DIAG_BUFFER_SIZE 64
+
+typedef enum _diag_severity
+{
+  DIAG_INFO,         /* normal recovery of the solver          */
+  DIAG_WARNING,      /* the results could be inaccurate        */
+  DIAG_ERROR         /* the computation was aborted or is wrong */
+} diag_severity_t;
+
+/* The conditions met by the solvers. Each one set the bit
+   DIAG_BIT(code) in the warnings of the solver statistics of the
+   equilibrium that raised it */
+typedef enum _diag_code
+{
+  DIAG_SINGULAR,          /* singular matrix of the equilibrium        */
+  DIAG_GAS_REINSERTED,    /* nothing to remove, gases reinserted       */
+  DIAG_NO_CONVERGENCE,    /* the equilibrium did not converge          */
+  DIAG_DERIVATIVE,        /* singular matrix of the derivatives        */
+  DIAG_TEMPERATURE,       /* frozen temperature did not converge       */
+  DIAG_THROAT,            /* throat pressure did not converge          */
+  DIAG_EXIT,              /* exit pressure did not converge            */
+  DIAG_NO_EQUILIBRIUM,    /* performance aborted on an equilibrium     */
+  DIAG_MAX_ELEMENT,       /* more than MAX_ELEMENT elements            */
+  DIAG_MAX_PRODUCT,       /* more than MAX_PRODUCT products            */
+  DIAG_BUDGET,            /* the work budget of the thread is spent    */
+  DIAG_LAST
+} diag_code_t;
+
+#define DIAG_BIT(code) (1u << (code))
+
+typedef struct _diag_message
+{
+  diag_severity_t severity;
+  diag_code_t     code;
+  long            case_id;
+  int             value;    /* iterations, species or limit reached */
+} diag_message_t;
+
+/* Receive the diagnostics of the thread it is attached to */
+typedef struct _diag_sink
+{
+  long            case_id;           /* set by the caller for each case  */
+  int             limit;             /* messages kept by code            */
+  FILE           *echo;              /* print the kept messages if set   */
+
+  unsigned long   count[DIAG_LAST];  /* raised, kept or not              */
+  int             n_message;
+  diag_message_t  message[DIAG_BUFFER_SIZE];
+} diag_sink_t;
+
+/***************************************************************
+FUNCTION: Initialize the sink s. At most limit messages of each
+          code are kept in the buffer (and printed on echo if it
+          is not NULL) until diag_clear(), the others are counted.
+****************************************************************/
+void diag_init(diag_sink_t *s, int limit, FILE *echo);
+
+/* Forget the messages and the counts of s, case_id is kept */
+void diag_clear(diag_sink_t *s);
+
+/***************************************************************
+FUNCTION: Attach s to the calling thread, the diagnostics raised
+          by this thread go to s. Return the sink attached before,
+          to be attached again when done. NULL detach the sink,
+          the diagnostics are then only kept in the warnings.
+****************************************************************/
+diag_sink_t *diag_attach(diag_sink_t *s);
+
+/* Sink attached to the calling thread, NULL if none */
+diag_sink_t *diag_attached(void);
+
+/***************************************************************
+FUNCTION: Raise the diagnostic code with value, set its bit in
+          the warnings of e (if not NULL) and give it to the sink
+          of the thread.
+
+COMMENTS: Nothing is allocated, and nothing is printed unless
+          the sink echo its messages. A raise cost a few
+          instructions when no sink is attached.
+****************************************************************/
+void diag_raise(equilibrium_t *e, diag_code_t code, int value);
+
+/* Print a message on fd, a line naming the case */
+int diag_print(FILE *fd, diag_message_t *m);
+
+/* Print on fd the number of messages of each code not kept by s */
+int diag_print_suppressed(FILE *fd, diag_sink_t *s);
+
+diag_severity_t diag_severity(diag_code_t code);
+const char *diag_severity_name(diag_severity_t severity);
+
+/* Short name ("singular", "throat"...) and text of a code */
+const char *diag_name(diag_code_t code);
+const char *diag_text(diag_code_t code);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef diskcache_h
+#define diskcache_h
+
+#include "equilibrium.h"
+
+/***************************************************************
+FUNCTION: Use the directory as a persistent cache of results.
+          The directory is created if it does not exist. A NULL
+          directory close the cache.
+
+COMMENTS: Each result is stored in its own file named after a
+          hash of the canonical inputs and of a checksum of the
+          thermo and propellant data. The complete key is kept in
+          the file and compared on read. Files are written under
+          a temporary name then renamed, so several processes can
+          share the same directory.
+****************************************************************/
+int disk_cache_open(char *directory);
+void disk_cache_close(void);
+
+/* Number of results read from and missing in the cache */
+void disk_cache_stats(unsigned long *hit, unsigned long *miss);
+
+/* Checksum of the loaded thermo and propellant data */
+unsigned long database_checksum(void);
+
+/***************************************************************
+FUNCTION: Same as equilibrium(), frozen_performance_multi() and
+          shifting_performance_multi() but the result is first
+          looked up in the cache directory, and stored in it
+          when it was computed.
+
+COMMENTS: When the cache is closed they just call the solver.
+****************************************************************/
+int disk_cached_equilibrium(equilibrium_t *e, problem_t P);
+int disk_cached_frozen_performance(equilibrium_t *e, int n_exit,
+                                   exit_condition_t *exit_type,
+                                   double *value);
+int disk_cached_shifting_performance(equilibrium_t *e, int n_exit,
+                                     exit_condition_t *exit_type,
+                                     double *value);
+
+#endif
@@ -18,6 +18,18 @@
 
 extern int global_verbose;
 
+/* Highest level of verbose output compiled in the solvers. The
+   tests of a level over it are constant and removed with their
+   printing by the compiler, the optimized build has none of them.
+   The debug build (make DEBUG=1) define it to 10 and print at the
+   level set in global_verbose. */
+#ifndef VERBOSE_MAX
+#define VERBOSE_MAX 0
+#endif
+
+#define VERBOSE(level) (((level) <= VERBOSE_MAX) && \
+                        (global_verbose >= (level)))
+
 
 /***************************************************************
 FUNCTION PROTOTYPE SECTION
@@ -65,6 +77,13 @@ int dealloc_equilibrium(equilibrium_t *e);
 
 int reset_equilibrium(equilibrium_t *e);
 
+/***************************************************************
+FUNCTION: Bring e back to the state of a zero filled structure
+          given to initialize_equilibrium. Only the part of the
+          arrays used by the previous problem is cleared.
+****************************************************************/
+int clear_equilibrium(equilibrium_t *e);
+
 int copy_equilibrium(equilibrium_t *dest, equilibrium_t *src);
 
 int compute_thermo_properties(equilibrium_t *e);
@@ -123,7 +142,7 @@ AUTHOR:   Antoine Lefebvre
 
 
 //#ifdef TRUE_ARRAY
-//int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P);
+int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P);
 int fill_matrix(double *matrix, equilibrium_t *e, problem_t P);
 //#else
 //int fill_equilibrium_matrix(double **matrix, equilibrium_t *e, problem_t P);
@@ -137,13 +156,48 @@ FUNCTION: This function compute the equilibrium composition at
 	  to obtain correction to initial estimate. It correct the 
 	  value until equilibrium is obtain.
 
+COMMENTS: Return ERR_BUDGET if the work budget of the thread is
+          exhausted (see budget.h), equil then hold the composition
+          of the last iteration and its properties.
+
 AUTHOR:   Antoine Lefebvre
 ******************************************************************/
 int equilibrium(equilibrium_t *equil, problem_t P);
 
+/* equilibrium() with its time counted in the chamber phase, used
+   where a chamber state is requested (see timer.h) */
+int chamber_state(equilibrium_t *equil, problem_t P);
+
+/***************************************************************
+FUNCTION: Add the counts, the time and the warnings of s to
+          total, the damping factor of total become the one of s.
+
+COMMENTS: Used to sum the equilibrium() of a station that need
+          several of them (the shifting throat and exit).
+****************************************************************/
+int solver_stats_add(solver_stats_t *total, solver_stats_t *s);
+
 
 double product_molar_mass(equilibrium_t *e);
 
+/***************************************************************
+FUNCTION: Fill species[n_species] with the thermo_list index of
+          the gaseous then the possible condensed products, the
+          unused columns are set to -1. Return the number of
+          products, call it with n_species = 0 to get the size.
+
+COMMENTS: The products must have been listed.
+****************************************************************/
+int product_columns(equilibrium_t *e, int n_species, short *species);
+
+/***************************************************************
+FUNCTION: Write in x[n_species] the molar fraction of each product
+          of the column list made by product_columns, for an
+          equilibrium with the same product list.
+****************************************************************/
+int product_molar_fractions(equilibrium_t *e, int n_species, short *species,
+                            double *x);
+
 #endif
 
 
@@ -0,0 +1,71 @@
+#ifndef output_h
+#define output_h
+
+#include <stdio.h>
+
+#include "equilibrium.h"
+
+/* Size of the buffer of a writer, the records are written to the
+   file when it is full */
+#define OUTPUT_BUFFER 8192
+
+typedef enum _output_format
+{
+  OUTPUT_TEXT,     /* the print.c printers */
+  OUTPUT_CSV,
+  OUTPUT_JSONL     /* one JSON object by line */
+} output_format_t;
+
+typedef struct _output
+{
+  FILE            *fd;
+  output_format_t  format;
+  int              header_written;   /* CSV column line */
+  size_t           length;           /* bytes waiting in buffer */
+  char             buffer[OUTPUT_BUFFER];
+} output_t;
+
+/***************************************************************
+FUNCTION: Prepare a writer of format on fd.
+
+COMMENTS: Return -1 if format is not OUTPUT_CSV or OUTPUT_JSONL.
+****************************************************************/
+int output_open(output_t *o, FILE *fd, output_format_t format);
+
+/* Return the format named name ("text", "csv" or "jsonl"), or -1 */
+int output_format(const char *name);
+
+/***************************************************************
+FUNCTION: Write one record for each of the npt stations of e
+          (chamber, throat, exit) of the case number n_case of
+          type case_type (e.g. "HP" or "FR").
+
+COMMENTS: The columns are, in this order:
+          case, type, station, P (atm), T (K), H, U, G (kJ/kg),
+          S, Cp, Cv (kJ/(kg)(K)), M (g/mol), dV_P, dV_T, gamma,
+          Vson (m/s), ae_at, a_dotm (m/s/atm), cstar (m/s), cf,
+          Ivac, Isp (m/s), warnings and composition.
+          The performance is empty (null in JSON) at the chamber.
+          warnings is the DIAG_BIT mask of the diagnostics raised
+          at the station (diag.h).
+          The composition list the molar fractions of the
+          products present at the station, "name=x" separated
+          by spaces in CSV and an object in JSON.
+****************************************************************/
+int output_record(output_t *o, int n_case, const char *case_type,
+                  equilibrium_t *e, short npt);
+
+/***************************************************************
+FUNCTION: Write the record {"case": n_case, "type": case_type,
+          "error": message} of a case that was not solved.
+
+COMMENTS: Only the JSON Lines writer has error records, return -1
+          for the other formats.
+****************************************************************/
+int output_error(output_t *o, int n_case, const char *case_type,
+                 const char *message);
+
+/* Write the buffered records to the file */
+int output_flush(output_t *o);
+
+#endif
@@ -14,5 +14,129 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
 int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
                          double value);
 
+/***************************************************************
+FUNCTION: Compute the performance for several exit conditions
+          at once. The chamber equilibrium and the throat are
+          computed only one time.
+
+PARAMETER: e is an array of n_exit + 2 equilibrium_t, e[0] is the
+           chamber, e[1] the throat and e[2 + i] the exit station
+           for the condition exit_type[i], value[i]. Subsonic,
+           supersonic area ratio and pressure could be mixed.
+
+COMMENTS: For shifting equilibrium, each exit equilibrium start
+          from the composition of the previous station.
+****************************************************************/
+int frozen_performance_multi(equilibrium_t *e, int n_exit,
+                             exit_condition_t *exit_type, double *value);
+int shifting_performance_multi(equilibrium_t *e, int n_exit,
+                               exit_condition_t *exit_type, double *value);
+
+
+/* Number of state variables written for each station by
+   nozzle_buffer_sink, before the composition columns */
+#define NOZZLE_NVAR 8
+
+/***************************************************************
+TYPE: State of the flow at one station of the nozzle.
+      ae_at is 0 for the chamber (infinite area).
+****************************************************************/
+typedef struct _nozzle_station
+{
+  int    index;  /* Station number, 0 is the chamber   */
+  double ae_at;  /* Station aera / Throat aera         */
+  double T;      /* Temperature (K)                    */
+  double P;      /* Pressure (atm)                     */
+  double rho;    /* Density (kg/m^3)                   */
+  double mach;   /* Mach number                        */
+  double gamma;  /* Isentropic exponent                */
+  double a;      /* Sound speed (m/s)                  */
+  double u;      /* Flow velocity (m/s)                */
+} nozzle_station_t;
+
+/* Receive each station as it is computed, e hold the composition.
+   A negative return value abort the profile. */
+typedef int (*nozzle_sink_t)(equilibrium_t *e, nozzle_station_t *s,
+                             void *data);
+
+/***************************************************************
+TYPE: Flat buffer filled by nozzle_buffer_sink. Each station
+      use NOZZLE_NVAR + n_species doubles:
+      ae_at, T, P, rho, mach, gamma, a, u followed by the molar
+      fraction of each species in the species column list.
+      The column list is filled at the first station with the
+      gaseous then the possible condensed products, unused
+      columns are set to -1.
+****************************************************************/
+typedef struct _nozzle_buffer
+{
+  int     size;       /* Number of stations the buffer could hold */
+  int     n;          /* Number of stations written               */
+  int     n_species;  /* Number of composition columns            */
+  short  *species;    /* thermo_list index of each column         */
+  double *data;       /* size * (NOZZLE_NVAR + n_species) doubles */
+} nozzle_buffer_t;
+
+/***************************************************************
+FUNCTION: March in the nozzle from the chamber to the exit and
+          give each station to sink as soon as it is computed.
+
+PARAMETER: e is an array of 3 equilibrium_t: the chamber, the
+           throat and the working station.
+           exit_type[i], value[i] give the n_station conditions
+           (subsonic, supersonic area ratio or pressure) in the
+           order of the expansion.
+
+COMMENTS: The chamber is the first station and the throat is
+          given before the first supersonic station. Each
+          station start from the previous one so small steps
+          are cheap.
+****************************************************************/
+int frozen_nozzle_profile(equilibrium_t *e, int n_station,
+                          exit_condition_t *exit_type, double *value,
+                          nozzle_sink_t sink, void *data);
+int shifting_nozzle_profile(equilibrium_t *e, int n_station,
+                            exit_condition_t *exit_type, double *value,
+                            nozzle_sink_t sink, void *data);
+
+/* Sink storing the stations in a nozzle_buffer_t given as data,
+   return ERR_BUFFER_FULL when there is no more room */
+int nozzle_buffer_sink(equilibrium_t *e, nozzle_station_t *s, void *data);
+
+/* Number of composition columns needed for the products of e,
+   its products must have been listed */
+int nozzle_buffer_columns(equilibrium_t *e);
+
+/* Flow separation is flagged when the exit pressure is lower than this
+   fraction of the ambient pressure (Summerfield criterion) */
+#define SEPARATION_PRESSURE_RATIO 0.4
+
+/***************************************************************
+FUNCTION: Compute the thrust coefficient and the delivered
+          specific impulse of a solved exit station for n
+          ambient pressures.
+
+PARAMETER: ex is an exit equilibrium computed by frozen_performance
+           or shifting_performance, pa[n] the ambient pressures (atm).
+           cf[n], isp[n] (m/s) and separated[n] receive the results,
+           separated[i] is true for over-expanded points where the
+           flow would separate from the nozzle wall.
+
+COMMENTS: Isp = Ivac - Pa * Ae/dotm, no equilibrium is computed.
+****************************************************************/
+int ambient_performance(equilibrium_t *ex, int n, double *pa,
+                        double *cf, double *isp, int *separated);
+
+/* Same as ambient_performance with the ambient pressures given by
+   the standard atmosphere at altitude[n] (m), returned in pa[n] */
+int altitude_performance(equilibrium_t *ex, int n, double *altitude,
+                         double *pa, double *cf, double *isp, int *separated);
+
+/***************************************************************
+FUNCTION: Pressure (atm) of the U.S. Standard Atmosphere 1976 at
+          a geometric altitude in meter. Return 0 above 86 km.
+****************************************************************/
+double standard_atmosphere_pressure(double altitude);
+
 #endif
 
@@ -0,0 +1,33 @@
+#ifndef pool_h
+#define pool_h
+
+#include "equilibrium.h"
+
+/* Blocks of at most POOL_MAX_BLOCK structures are recycled, and at
+   most POOL_MAX_FREE free blocks are kept for each size */
+#define POOL_MAX_BLOCK 16
+#define POOL_MAX_FREE  64
+
+/***************************************************************
+FUNCTION: Return a block of n contiguous equilibrium_t ready to
+          be used, as after initialize_equilibrium, or NULL if
+          the memory could not be allocated.
+
+COMMENTS: A recycled block is only cleared on the part used by
+          its previous problem (see clear_equilibrium). The pool
+          can be used by several threads at the same time.
+****************************************************************/
+equilibrium_t *equilibrium_pool_get(int n);
+
+/* Give back a block of n structures returned by equilibrium_pool_get */
+void equilibrium_pool_release(equilibrium_t *e, int n);
+
+/* Free all the blocks kept in the pool */
+void equilibrium_pool_trim(void);
+
+/* Number of blocks allocated, recycled and currently in the pool */
+void equilibrium_pool_stats(unsigned long *allocated,
+                            unsigned long *recycled,
+                            unsigned long *free_blocks);
+
+#endif
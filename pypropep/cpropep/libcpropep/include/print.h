@@ -12,6 +12,9 @@
 extern FILE * errorfile;
 extern FILE * outputfile;
 
+/* message of the error code c is err_message[-c - 1] */
+extern char err_message[][64];
+
 int print_error_message(int error_code);
 
 /***************************************************************
@@ -19,5 +19,8 @@
 #define ERR_AERA_RATIO       -7
 #define ERR_RATIO_TYPE       -8
 #define ERR_TOO_MANY_ITER       -9
+#define ERR_BUFFER_FULL        -10
+#define ERR_BAD_SNAPSHOT       -11
+#define ERR_BUDGET             -12
 
 #endif	/* !defined(RETURN_H) */
@@ -0,0 +1,38 @@
+#ifndef snapshot_h
+#define snapshot_h
+
+#include "equilibrium.h"
+
+/***************************************************************
+FUNCTION: Return the size in bytes of the snapshot of e.
+****************************************************************/
+int equilibrium_snapshot_size(equilibrium_t *e);
+
+/***************************************************************
+FUNCTION: Write in buffer a compact snapshot of e: the
+          composition, the element and product lists, the mol
+          numbers, the state, the properties and the performance.
+          Return the number of bytes written.
+
+PARAMETER: size is the size of buffer, ERR_BUFFER_FULL is
+           returned if it is smaller than
+           equilibrium_snapshot_size(e).
+
+COMMENTS: Only the used part of the arrays is written. The
+          snapshot is in the byte order of the machine and is
+          tied to the loaded data by their checksum.
+****************************************************************/
+int save_equilibrium(equilibrium_t *e, char *buffer, int size);
+
+/***************************************************************
+FUNCTION: Restore e from a snapshot written by save_equilibrium.
+          The elements and the products are not listed again and
+          a following call to equilibrium() start from the
+          restored state.
+
+COMMENTS: Return ERR_BAD_SNAPSHOT if the snapshot is truncated,
+          of another version or was taken with other data.
+****************************************************************/
+int restore_equilibrium(equilibrium_t *e, const char *buffer, int size);
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef sweep_h
+#define sweep_h
+
+#include "equilibrium.h"
+
+/* Values written for the chamber, the throat and the exit:
+   P, T, H, S, M, Cp, Isex, Vson */
+#define SWEEP_STATION_NVAR 8
+
+/* Values written for each point before the molar fractions:
+   the mixture ratio, the 3 stations and the exit performance
+   ae_at, a_dotm, cstar, cf, Ivac, Isp */
+#define SWEEP_NVAR (1 + 3 * SWEEP_STATION_NVAR + 6)
+
+/***************************************************************
+FUNCTION: Prepare e (an array of 3 equilibrium_t) for a sweep of
+          the mixture of fuel and oxidizer, the elements and the
+          products are listed only one time.
+          Return the number of molar fraction columns of a point.
+****************************************************************/
+int sweep_columns(equilibrium_t *e, composition_t *fuel,
+                  composition_t *oxidizer);
+
+/***************************************************************
+FUNCTION: Compute the performance of n points in one call.
+
+PARAMETER: e is the array prepared by sweep_columns.
+           of[n] is the oxidizer / fuel mass ratio, pc[n] the
+           chamber pressure (atm) and value[n] the exit condition
+           of type exit_type of each point.
+           data receive n rows of SWEEP_NVAR + n_species doubles,
+           the molar fractions at the exit follow the column list
+           species[n_species] filled from the first point.
+           status[n] receive the return code of each point, the
+           row of a point that failed is set to 0.
+
+COMMENTS: A failed point do not stop the sweep. The results go
+          through the disk and chamber caches when they are
+          enabled.
+****************************************************************/
+int frozen_performance_sweep(equilibrium_t *e, composition_t *fuel,
+                             composition_t *oxidizer, int n, double *of,
+                             double *pc, exit_condition_t exit_type,
+                             double *value, int n_species, short *species,
+                             double *data, int *status);
+int shifting_performance_sweep(equilibrium_t *e, composition_t *fuel,
+                               composition_t *oxidizer, int n, double *of,
+                               double *pc, exit_condition_t exit_type,
+                               double *value, int n_species, short *species,
+                               double *data, int *status);
+
+#endif
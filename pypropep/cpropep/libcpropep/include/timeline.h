@@ -0,0 +1,64 @@
+#ifndef timeline_h
+#define timeline_h
+
+#include "timer.h"
+
+/* Events kept by each thread, the oldest ones are overwritten when
+   a thread record more */
+#define TIMELINE_RING_SIZE 16384
+
+/* The timeline of the solver internals (equilibrium and Newton
+   iterations, LU solves, condensed species changes, throat and exit
+   iterations) is compiled only when TIMELINE is defined, nothing is
+   recorded and no code is generated without it.
+
+   TIMELINE_SPAN record the span from TIMELINE_START(t) to now and
+   TIMELINE_MARK an instant. name must be a string constant, arg is
+   an integer shown with the event (iteration, size of the matrix,
+   species...). */
+#ifdef TIMELINE
+#define TIMELINE_VAR(t)             double t;
+#define TIMELINE_START(t)           ((t) = timer_now())
+#define TIMELINE_SPAN(t, name, arg) timeline_span((name), (t), (arg))
+#define TIMELINE_MARK(name, arg)    timeline_mark((name), (arg))
+#else
+#define TIMELINE_VAR(t)
+#define TIMELINE_START(t)
+#define TIMELINE_SPAN(t, name, arg)
+#define TIMELINE_MARK(name, arg)
+#endif
+
+/* Return true if the library was compiled with the timeline */
+int timeline_enabled(void);
+
+/***************************************************************
+FUNCTION: Add an event to the ring of the calling thread.
+
+COMMENTS: No lock is taken, a thread take its ring under a lock
+          only at its first event. The ring of a thread that
+          terminated is kept, so its lane is still written, and
+          given to the next new thread: there are as many rings
+          as threads running at the same time (with pthreads, a
+          ring per thread elsewhere).
+****************************************************************/
+void timeline_span(const char *name, double start, int arg);
+void timeline_mark(const char *name, int arg);
+
+/***************************************************************
+FUNCTION: Write the events of every thread in filename in the
+          Chrome trace event format (a JSON object), opened with
+          chrome://tracing or ui.perfetto.dev. Each thread is a
+          lane, the time is in microseconds from the first event.
+
+COMMENTS: Must be called while no solver is running, the events
+          being recorded may be missed or partially written.
+****************************************************************/
+int timeline_write(const char *filename);
+
+/* Forget all the events, same restriction as timeline_write */
+void timeline_reset(void);
+
+/* Number of events recorded and overwritten since the last reset */
+void timeline_stats(unsigned long *recorded, unsigned long *dropped);
+
+#endif
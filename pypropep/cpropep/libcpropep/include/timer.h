@@ -0,0 +1,64 @@
+#ifndef timer_h
+#define timer_h
+
+#include <stdio.h>
+
+/* The timed phases of a run. They nest: the derivative time is also
+   counted in the phase that solved the equilibrium, and the product
+   listing done by a first equilibrium in the chamber phase */
+typedef enum _timer_phase
+{
+  TIMER_LOAD,         /* loading of the thermo and propellant data */
+  TIMER_LIST,         /* list_element and list_product             */
+  TIMER_CHAMBER,      /* chamber equilibrium                       */
+  TIMER_THROAT,       /* throat iteration                          */
+  TIMER_EXIT,         /* exit iteration of each exit station       */
+  TIMER_DERIVATIVE,   /* derivative()                              */
+  TIMER_LAST
+} timer_phase_t;
+
+typedef struct _timer_stat
+{
+  unsigned long count;   /* number of times the phase was run */
+  double        total;   /* total time (s)                    */
+  double        max;     /* longest run (s)                   */
+} timer_stat_t;
+
+/* The timers are compiled only when TIMING is defined, the
+   functions below are always there but nothing is measured
+   without it */
+#ifdef TIMING
+#define TIMER_VAR(t)         double t;
+#define TIMER_START(t)       ((t) = timer_now())
+#define TIMER_STOP(t, phase) timer_add((phase), timer_now() - (t))
+#else
+#define TIMER_VAR(t)
+#define TIMER_START(t)
+#define TIMER_STOP(t, phase)
+#endif
+
+/* Return true if the library was compiled with the timers */
+int timer_enabled(void);
+
+/* Monotonic clock in seconds, from an arbitrary origin */
+double timer_now(void);
+
+/* Add a run of seconds to phase in the statistics of the calling
+   thread, no lock is taken after the first run of a thread. The
+   statistics of a thread that terminated are kept and continued by
+   the next new thread. */
+void timer_add(timer_phase_t phase, double seconds);
+
+/* Copy the TIMER_LAST statistics in stats, summed over the threads */
+void timer_stats(timer_stat_t *stats);
+
+/* Reset all the statistics to zero */
+void timer_reset(void);
+
+/* Name of a phase */
+const char *timer_name(timer_phase_t phase);
+
+/* Print a table of the statistics on fd */
+int timer_report(FILE *fd);
+
+#endif
@@ -0,0 +1,80 @@
+#ifndef trace_h
+#define trace_h
+
+#include <stdio.h>
+
+#include "equilibrium.h"
+
+/* Most exit conditions of a recorded performance request, the
+   requests with more are not recorded */
+#define TRACE_MAX_EXIT 64
+
+typedef enum _trace_kind
+{
+  TRACE_EQUILIBRIUM,   /* equilibrium()               */
+  TRACE_FROZEN,        /* frozen_performance_multi()   */
+  TRACE_SHIFTING,      /* shifting_performance_multi() */
+  TRACE_LAST
+} trace_kind_t;
+
+/* A request read from a trace */
+typedef struct _trace_request
+{
+  trace_kind_t     kind;
+  problem_t        problem;      /* of an equilibrium request      */
+  composition_t    propellant;   /* ncomp, molecule and coef (mol) */
+  double           P;            /* pressure (atm)                 */
+  double           T;            /* temperature (K), TP or guess   */
+  double           entropy;      /* target of SP                   */
+  int              n_exit;
+  exit_condition_t exit_type[TRACE_MAX_EXIT];
+  double           value[TRACE_MAX_EXIT];
+} trace_request_t;
+
+/***************************************************************
+FUNCTION: Record in filename every request that reach the solvers
+          (equilibrium(), frozen_performance_multi() and
+          shifting_performance_multi()), until trace_close().
+
+COMMENTS: Only the outer request is recorded, not the equilibria
+          solved by a performance evaluation. The results taken
+          from the caches did not reach the solvers and are not
+          recorded. The trace begin with the magic "CPTRACE1" and
+          the database_checksum(), followed by the requests:
+            char   kind, problem
+            short  ncomp, then ncomp times
+              short  molecule
+              double coef
+            double P, T, entropy
+            short  n_exit, then n_exit times
+              char   exit_type
+              double value
+          in the byte order of the machine.
+****************************************************************/
+int trace_open(const char *filename);
+int trace_close(void);
+
+/* Number of requests recorded and not recorded since trace_open */
+void trace_stats(unsigned long *recorded, unsigned long *dropped);
+
+/***************************************************************
+FUNCTION: Called by the solvers around a request, trace_begin
+          record it if it is an outer request and return true
+          when trace_end must be called.
+****************************************************************/
+int trace_begin(trace_kind_t kind, equilibrium_t *e, problem_t P,
+                int n_exit, exit_condition_t *exit_type, double *value);
+void trace_end(int traced);
+
+/***************************************************************
+FUNCTION: Read the header of the trace fd and its checksum.
+          Read the next request of fd in r, return ERR_EOF at the
+          end of the trace.
+****************************************************************/
+int trace_read_header(FILE *fd, unsigned long *checksum);
+int trace_read(FILE *fd, trace_request_t *r);
+
+/* Name of a kind of request ("equilibrium", "frozen", "shifting") */
+const char *trace_kind_name(trace_kind_t kind);
+
+#endif
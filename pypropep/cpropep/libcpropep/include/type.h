@@ -51,6 +51,8 @@ typedef struct _performance_prop
   double cf;      /* Coefficient of thrust                */
   double Ivac;    /* Specific impulse (vacuum)            */
   double Isp;     /* Specific impulse                     */
+  double residual; /* of the throat or exit iteration     */
+  int    iterations; /* states computed by the iteration */
   
 } performance_prop_t;
 
@@ -140,6 +142,20 @@ typedef struct _equilib_prop
 } equilib_prop_t;
 
 
+/* Work done by the last equilibrium() on a structure */
+typedef struct _solver_stats
+{
+  int    iterations; /* Newton iterations, over all the restarts  */
+  int    restarts;   /* times the iteration counter was reset     */
+  int    lu;         /* LU solves, derivative() included          */
+  int    singular;   /* LU solves on a singular matrix            */
+  int    inserted;   /* condensed species inserted                */
+  int    removed;    /* condensed species removed                 */
+  double lambda;     /* damping factor of the last correction     */
+  double time;       /* wall time (s)                             */
+  unsigned int warnings; /* DIAG_BIT of the diagnostics raised    */
+} solver_stats_t;
+
 typedef struct _new_equilibrium
 {  
   int equilibrium_ok;  /* true if the equilibrium have been compute */
@@ -154,6 +170,7 @@ typedef struct _new_equilibrium
   product_t          product;
   equilib_prop_t     properties;
   performance_prop_t performance;
+  solver_stats_t     stats;
   
 } equilibrium_t;
 
@@ -0,0 +1,75 @@
+/* budget.c  -  Work budget of the solvers                             */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+
+#include "budget.h"
+#include "timer.h"
+
+#include "compat.h"
+#include "mutex.h"
+
+static THREAD_LOCAL solver_budget_t *budget = NULL;
+
+void budget_init(solver_budget_t *b, int max_iterations, int max_restarts,
+                 double timeout)
+{
+  b->max_iterations = max_iterations;
+  b->max_restarts   = max_restarts;
+  b->deadline       = (timeout > 0.0) ? timer_now() + timeout : 0.0;
+
+  b->iterations = 0;
+  b->restarts   = 0;
+  b->exhausted  = false;
+}
+
+solver_budget_t *budget_attach(solver_budget_t *b)
+{
+  solver_budget_t *previous = budget;
+  budget = b;
+  return previous;
+}
+
+solver_budget_t *budget_attached(void)
+{
+  return budget;
+}
+
+/* Test the limits of b, once exhausted it stay so */
+static int check(solver_budget_t *b)
+{
+  if (!b->exhausted &&
+      (((b->max_iterations > 0) && (b->iterations > b->max_iterations)) ||
+       ((b->max_restarts > 0) && (b->restarts > b->max_restarts)) ||
+       ((b->deadline > 0.0) && (timer_now() > b->deadline))))
+    b->exhausted = true;
+
+  return b->exhausted;
+}
+
+int budget_iteration(void)
+{
+  if (budget == NULL)
+    return false;
+
+  budget->iterations++;
+  return check(budget);
+}
+
+int budget_restart(void)
+{
+  if (budget == NULL)
+    return false;
+
+  budget->restarts++;
+  return check(budget);
+}
+
+int budget_exhausted(void)
+{
+  if (budget == NULL)
+    return false;
+
+  return check(budget);
+}
@@ -0,0 +1,429 @@
+/* cache.c  -  Cache of converged equilibrium states                  */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "equilibrium.h"
+#include "thermo.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+/* Canonical description of an equilibrium problem */
+typedef struct _cache_key
+{
+  problem_t     P;
+  composition_t comp;      /* canonical composition      */
+  double        pressure;
+  double        target;    /* T for TP, entropy for SP   */
+} cache_key_t;
+
+typedef struct _cache_entry
+{
+  cache_key_t   key;
+  unsigned long hash;
+  int           next;      /* in the bucket or the free list */
+  int           newer;     /* in the LRU list                */
+  int           older;
+  int           pins;      /* copies in progress, unlocked   */
+  int           stale;     /* cleared while pinned           */
+  equilibrium_t state;
+} cache_entry_t;
+
+#define NO_ENTRY -1
+
+static cache_entry_t *cache      = NULL;
+static int            cache_size = 0;
+static int           *bucket     = NULL; /* first entry of each hash */
+static unsigned long  n_bucket   = 0;    /* a power of 2              */
+static int            cache_free   = NO_ENTRY;
+static int            cache_newest = NO_ENTRY;
+static int            cache_oldest = NO_ENTRY;
+static int            cache_pins   = 0;  /* over all the entries      */
+
+static unsigned long  cache_version = 0; /* database_version of states */
+static unsigned long  cache_hit     = 0;
+static unsigned long  cache_miss    = 0;
+
+/* the cache is shared by the threads, the solve and the copies of
+   the states are done unlocked. cache_unpinned is signaled when the
+   last copy end. */
+static mutex_t        cache_lock     = MUTEX_INITIALIZER;
+static cond_t         cache_unpinned = COND_INITIALIZER;
+
+
+/* Put all the entries in the free list, the pinned ones are freed
+   by their last unpin */
+static void empty_cache(void)
+{
+  int i;
+  unsigned long b;
+
+  for (b = 0; b < n_bucket; b++)
+    bucket[b] = NO_ENTRY;
+
+  cache_free   = NO_ENTRY;
+  cache_newest = NO_ENTRY;
+  cache_oldest = NO_ENTRY;
+
+  for (i = cache_size - 1; i >= 0; i--)
+  {
+    if (cache[i].pins > 0)
+      cache[i].stale = true;
+    else
+    {
+      cache[i].next = cache_free;
+      cache_free    = i;
+    }
+  }
+}
+
+int equilibrium_cache_enable(int size)
+{
+  int err_code = SUCCESS;
+
+  mutex_lock(&cache_lock);
+
+  /* wait for the copies in progress in the states to be freed */
+  while (cache_pins > 0)
+    cond_wait(&cache_unpinned, &cache_lock);
+
+  free(cache);
+  free(bucket);
+  cache      = NULL;
+  bucket     = NULL;
+  cache_size = 0;
+  n_bucket   = 0;
+
+  if (size > 0)
+  {
+    for (n_bucket = 1; n_bucket < (unsigned long) size; n_bucket *= 2)
+      ;
+
+    cache  = (cache_entry_t *) malloc(size * sizeof(cache_entry_t));
+    bucket = (int *) malloc(n_bucket * sizeof(int));
+    if ((cache == NULL) || (bucket == NULL))
+    {
+      free(cache);
+      free(bucket);
+      cache    = NULL;
+      bucket   = NULL;
+      n_bucket = 0;
+      err_code = ERR_MALLOC;
+    }
+    else
+    {
+      memset(cache, 0, size * sizeof(cache_entry_t));
+      cache_size    = size;
+      cache_version = database_version;
+      empty_cache();
+    }
+  }
+
+  mutex_unlock(&cache_lock);
+  return err_code;
+}
+
+void equilibrium_cache_clear(void)
+{
+  mutex_lock(&cache_lock);
+  empty_cache();
+  cache_version = database_version;
+  mutex_unlock(&cache_lock);
+}
+
+void equilibrium_cache_stats(unsigned long *hit, unsigned long *miss)
+{
+  mutex_lock(&cache_lock);
+  *hit  = cache_hit;
+  *miss = cache_miss;
+  mutex_unlock(&cache_lock);
+}
+
+int canonical_composition(composition_t *src, composition_t *dest)
+{
+  int    i, j;
+  double total = 0.0;
+
+  dest->ncomp   = 0;
+  dest->density = 0.0;
+
+  /* insertion sort of the ingredients, the same molecule given
+     twice is merged */
+  for (i = 0; i < src->ncomp; i++)
+  {
+    for (j = 0; j < dest->ncomp; j++)
+      if (dest->molecule[j] >= src->molecule[i])
+        break;
+
+    if ((j < dest->ncomp) && (dest->molecule[j] == src->molecule[i]))
+    {
+      dest->coef[j] += src->coef[i];
+      continue;
+    }
+
+    memmove(dest->molecule + j + 1, dest->molecule + j,
+            (dest->ncomp - j) * sizeof(short));
+    memmove(dest->coef + j + 1, dest->coef + j,
+            (dest->ncomp - j) * sizeof(double));
+    dest->molecule[j] = src->molecule[i];
+    dest->coef[j]     = src->coef[i];
+    dest->ncomp++;
+  }
+
+  for (i = 0; i < dest->ncomp; i++)
+    total += dest->coef[i];
+
+  for (i = 0; i < dest->ncomp; i++)
+    dest->coef[i] /= total;
+
+  return SUCCESS;
+}
+
+static void make_key(cache_key_t *k, equilibrium_t *e, problem_t P)
+{
+  k->P        = P;
+  k->pressure = e->properties.P;
+
+  if (P == TP)
+    k->target = e->properties.T;
+  else if (P == SP)
+    k->target = e->entropy;
+  else
+    k->target = 0.0;
+
+  canonical_composition(&(e->propellant), &(k->comp));
+}
+
+/* FNV-1a over n bytes */
+static unsigned long hash_bytes(unsigned long h, const void *p, size_t n)
+{
+  const unsigned char *c = (const unsigned char *) p;
+
+  while (n--)
+  {
+    h ^= *c++;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+static unsigned long hash_key(cache_key_t *k)
+{
+  unsigned long h = 2166136261UL;
+
+  h = hash_bytes(h, &(k->P), sizeof(problem_t));
+  h = hash_bytes(h, &(k->pressure), sizeof(double));
+  h = hash_bytes(h, &(k->target), sizeof(double));
+  h = hash_bytes(h, &(k->comp.ncomp), sizeof(short));
+  h = hash_bytes(h, k->comp.molecule, k->comp.ncomp * sizeof(short));
+  h = hash_bytes(h, k->comp.coef, k->comp.ncomp * sizeof(double));
+  return h;
+}
+
+static int same_key(cache_key_t *a, cache_key_t *b)
+{
+  int i;
+
+  if ((a->P != b->P) || (a->comp.ncomp != b->comp.ncomp) ||
+      (a->pressure != b->pressure) || (a->target != b->target))
+    return false;
+
+  for (i = 0; i < a->comp.ncomp; i++)
+    if ((a->comp.molecule[i] != b->comp.molecule[i]) ||
+        (a->comp.coef[i] != b->comp.coef[i]))
+      return false;
+
+  return true;
+}
+
+/* The LRU list, newest first */
+static void lru_remove(int i)
+{
+  cache_entry_t *c = cache + i;
+
+  if (c->newer != NO_ENTRY)
+    cache[c->newer].older = c->older;
+  else
+    cache_newest = c->older;
+
+  if (c->older != NO_ENTRY)
+    cache[c->older].newer = c->newer;
+  else
+    cache_oldest = c->newer;
+}
+
+static void lru_push(int i)
+{
+  cache[i].newer = NO_ENTRY;
+  cache[i].older = cache_newest;
+  if (cache_newest != NO_ENTRY)
+    cache[cache_newest].newer = i;
+  else
+    cache_oldest = i;
+  cache_newest = i;
+}
+
+static int find_entry(cache_key_t *k, unsigned long h)
+{
+  int i;
+
+  for (i = bucket[h & (n_bucket - 1)]; i != NO_ENTRY; i = cache[i].next)
+    if ((cache[i].hash == h) && same_key(k, &(cache[i].key)))
+      return i;
+  return NO_ENTRY;
+}
+
+/* Remove a linked entry from its bucket and the LRU list */
+static void unlink_entry(int i)
+{
+  int *p = bucket + (cache[i].hash & (n_bucket - 1));
+
+  while (*p != i)
+    p = &(cache[*p].next);
+  *p = cache[i].next;
+
+  lru_remove(i);
+}
+
+/* A free entry, or the least recently used one that is not being
+   copied. NO_ENTRY if all of them are. */
+static int take_entry(void)
+{
+  int i;
+
+  if ((i = cache_free) != NO_ENTRY)
+  {
+    cache_free = cache[i].next;
+    return i;
+  }
+
+  for (i = cache_oldest; i != NO_ENTRY; i = cache[i].newer)
+  {
+    if (cache[i].pins == 0)
+    {
+      unlink_entry(i);
+      return i;
+    }
+  }
+  return NO_ENTRY;
+}
+
+static void pin(int i)
+{
+  cache[i].pins++;
+  cache_pins++;
+}
+
+/* The entry is freed if the cache was cleared during the copy */
+static void unpin(int i)
+{
+  cache[i].pins--;
+  cache_pins--;
+  if (cache_pins == 0)
+    cond_broadcast(&cache_unpinned);
+  if ((cache[i].pins == 0) && cache[i].stale)
+  {
+    cache[i].stale = false;
+    cache[i].next  = cache_free;
+    cache_free     = i;
+  }
+}
+
+int cached_equilibrium(equilibrium_t *e, problem_t P)
+{
+  int i;
+  int err_code;
+
+  cache_key_t    key;
+  unsigned long  h;
+  composition_t  propellant;
+  unsigned int   warnings;
+
+  mutex_lock(&cache_lock);
+
+  if (cache_size == 0)
+  {
+    mutex_unlock(&cache_lock);
+    return chamber_state(e, P);
+  }
+
+  /* the states were computed with other data */
+  if (cache_version != database_version)
+  {
+    empty_cache();
+    cache_version = database_version;
+  }
+
+  make_key(&key, e, P);
+  h = hash_key(&key);
+
+  if ((i = find_entry(&key, h)) != NO_ENTRY)
+  {
+    lru_remove(i);
+    lru_push(i);
+    pin(i);
+    cache_hit++;
+    mutex_unlock(&cache_lock);
+
+    /* the caller composition is kept as is, it could be given
+       in another order or scale */
+    propellant = e->propellant;
+    copy_equilibrium(e, &(cache[i].state));
+    e->propellant = propellant;
+
+    /* no work was done for this one, the warnings of the
+       solve still apply to the result */
+    warnings = e->stats.warnings;
+    memset(&(e->stats), 0, sizeof(solver_stats_t));
+    e->stats.warnings = warnings;
+
+    mutex_lock(&cache_lock);
+    unpin(i);
+    mutex_unlock(&cache_lock);
+    return SUCCESS;
+  }
+
+  cache_miss++;
+  mutex_unlock(&cache_lock);
+
+  if ((err_code = chamber_state(e, P)) < 0)
+    return err_code;
+
+  mutex_lock(&cache_lock);
+
+  /* the cache could have been disabled during the solve, or all its
+     entries be in use */
+  if ((cache_size == 0) || ((i = take_entry()) == NO_ENTRY))
+  {
+    mutex_unlock(&cache_lock);
+    return err_code;
+  }
+  pin(i);
+  mutex_unlock(&cache_lock);
+
+  copy_equilibrium(&(cache[i].state), e);
+
+  mutex_lock(&cache_lock);
+  cache[i].key  = key;
+  cache[i].hash = h;
+  if (cache[i].stale || (find_entry(&key, h) != NO_ENTRY))
+  {
+    /* cleared during the copy, or stored by another thread */
+    cache[i].stale = true;
+  }
+  else
+  {
+    cache[i].next = bucket[h & (n_bucket - 1)];
+    bucket[h & (n_bucket - 1)] = i;
+    lru_push(i);
+  }
+  unpin(i);
+
+  mutex_unlock(&cache_lock);
+  return err_code;
+}
@@ -22,6 +22,9 @@
 #include "print.h"
 #include "compat.h"
 #include "return.h"
+#include "timer.h"
+#include "timeline.h"
+#include "diag.h"
 
 int fill_temperature_derivative_matrix(double *matrix, equilibrium_t *e);
 int fill_pressure_derivative_matrix(double *matrix, equilibrium_t *e);
@@ -74,13 +77,18 @@ double mixture_specific_heat(equilibrium_t *e, double *sol)
 
 int derivative(equilibrium_t *e)
 {
+  int err_code;
   short size;
   double *matrix;
   double *sol;
 
   product_t      *p    = &(e->product);
   equilib_prop_t *prop = &(e->properties);
-  
+
+  TIMER_VAR(timer)
+  TIMELINE_VAR(lu)
+
+  TIMER_START(timer);
   
   /* the size of the coefficient matrix */
   size = p->n_element + p->n[CONDENSED] + 1;
@@ -91,39 +99,38 @@ int derivative(equilibrium_t *e)
   sol = (double *) calloc (size, sizeof(double));
 
   fill_temperature_derivative_matrix(matrix, e);
-  
-  if (NUM_lu(matrix, sol, size) == -1)
+
+  e->stats.lu++;
+  TIMELINE_START(lu);
+  err_code = NUM_lu(matrix, sol, size);
+  TIMELINE_SPAN(lu, "lu", size);
+  if (err_code != 0)
+    diag_raise(e, DIAG_DERIVATIVE, size);
+
+  if (VERBOSE(3))
   {
-    fprintf(outputfile, "The matrix is singular.\n");
+    fprintf(outputfile, "Temperature derivative results.\n");
+    NUM_print_vec(sol, size);
   }
-  else
-  {
-    if (global_verbose > 2)
-    {
-      fprintf(outputfile, "Temperature derivative results.\n");
-      NUM_print_vec(sol, size);
-    }
     
-    prop->Cp   = mixture_specific_heat(e, sol)*R;
-    prop->dV_T = 1 + sol[e->product.n_element + e->product.n[CONDENSED]];  
-  }
+  prop->Cp   = mixture_specific_heat(e, sol)*R;
+  prop->dV_T = 1 + sol[e->product.n_element + e->product.n[CONDENSED]];
 
   fill_pressure_derivative_matrix(matrix, e);
 
-  if (NUM_lu(matrix, sol, size) == -1)
-  {
-    fprintf(outputfile, "The matrix is singular.\n");
-  }
-  else
+  e->stats.lu++;
+  TIMELINE_START(lu);
+  err_code = NUM_lu(matrix, sol, size);
+  TIMELINE_SPAN(lu, "lu", size);
+  if (err_code != 0)
+    diag_raise(e, DIAG_DERIVATIVE, size);
+
+  if (VERBOSE(3))
   {
-    if (global_verbose > 2)
-    {
-      fprintf(outputfile, "Pressure derivative results.\n");
-      NUM_print_vec(sol, size);
-    }
-    prop->dV_P = sol[e->product.n_element + e->product.n[CONDENSED]] - 1;
-    
+    fprintf(outputfile, "Pressure derivative results.\n");
+    NUM_print_vec(sol, size);
   }
+  prop->dV_P = sol[e->product.n_element + e->product.n[CONDENSED]] - 1;
 
   prop->Cv    = prop->Cp + e->itn.n * R * pow(prop->dV_T, 2)/prop->dV_P;
   prop->Isex  = -(prop->Cp / prop->Cv) / prop->dV_P;
@@ -131,6 +138,8 @@ int derivative(equilibrium_t *e)
   
   free(matrix);
   free(sol);
+
+  TIMER_STOP(timer, TIMER_DERIVATIVE);
   return 0;
 }
 
@@ -0,0 +1,154 @@
+/* diag.c  -  Diagnostics of the solvers                               */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "diag.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+static const struct
+{
+  diag_severity_t severity;
+  const char     *name;
+  const char     *text;
+} diag_table[DIAG_LAST] = {
+  { DIAG_WARNING, "singular",
+    "The matrix is singular, no unique solution" },
+  { DIAG_INFO,    "gas_reinserted",
+    "No condensed removed, reinserting the removed gases" },
+  { DIAG_ERROR,   "no_convergence",
+    "No convergence, don't trust results" },
+  { DIAG_WARNING, "derivative",
+    "The matrix of the derivatives is singular, don't trust results" },
+  { DIAG_WARNING, "temperature",
+    "Temperature do not converge, don't trust results" },
+  { DIAG_WARNING, "throat",
+    "Throat pressure do not converge, don't trust results" },
+  { DIAG_WARNING, "exit",
+    "Exit pressure do not converge, don't trust results" },
+  { DIAG_ERROR,   "no_equilibrium",
+    "No equilibrium, performance evaluation aborted" },
+  { DIAG_ERROR,   "max_element",
+    "Maximum number of elements reached" },
+  { DIAG_ERROR,   "max_product",
+    "Maximum number of products reached, change MAX_PRODUCT and recompile" },
+  { DIAG_ERROR,   "budget",
+    "Work budget exhausted, partial results" }
+};
+
+static const char *severity_name[] = { "info", "warning", "error" };
+
+static THREAD_LOCAL diag_sink_t *sink = NULL;
+
+void diag_init(diag_sink_t *s, int limit, FILE *echo)
+{
+  s->case_id = 0;
+  s->limit   = limit;
+  s->echo    = echo;
+  diag_clear(s);
+}
+
+void diag_clear(diag_sink_t *s)
+{
+  memset(s->count, 0, sizeof(s->count));
+  s->n_message = 0;
+}
+
+diag_sink_t *diag_attach(diag_sink_t *s)
+{
+  diag_sink_t *previous = sink;
+  sink = s;
+  return previous;
+}
+
+diag_sink_t *diag_attached(void)
+{
+  return sink;
+}
+
+void diag_raise(equilibrium_t *e, diag_code_t code, int value)
+{
+  diag_message_t *m;
+
+  if ((code < 0) || (code >= DIAG_LAST))
+    return;
+
+  if (e != NULL)
+    e->stats.warnings |= DIAG_BIT(code);
+
+  if (sink == NULL)
+    return;
+
+  /* rate limiting, the messages over the limit are only counted */
+  if ((sink->count[code]++ >= (unsigned long) sink->limit) ||
+      (sink->n_message == DIAG_BUFFER_SIZE))
+    return;
+
+  m = sink->message + sink->n_message++;
+  m->severity = diag_table[code].severity;
+  m->code     = code;
+  m->case_id  = sink->case_id;
+  m->value    = value;
+
+  if (sink->echo != NULL)
+    diag_print(sink->echo, m);
+}
+
+int diag_print(FILE *fd, diag_message_t *m)
+{
+  fprintf(fd, "%s: %s (%d), case %ld\n", diag_severity_name(m->severity),
+          diag_text(m->code), m->value, m->case_id);
+  return SUCCESS;
+}
+
+int diag_print_suppressed(FILE *fd, diag_sink_t *s)
+{
+  int           i;
+  unsigned long kept[DIAG_LAST];
+
+  memset(kept, 0, sizeof(kept));
+  for (i = 0; i < s->n_message; i++)
+    kept[s->message[i].code]++;
+
+  for (i = 0; i < DIAG_LAST; i++)
+  {
+    if (s->count[i] > kept[i])
+      fprintf(fd, "%s: %lu more \"%s\", case %ld\n",
+              diag_severity_name(diag_table[i].severity),
+              s->count[i] - kept[i], diag_table[i].text, s->case_id);
+  }
+  return SUCCESS;
+}
+
+diag_severity_t diag_severity(diag_code_t code)
+{
+  if ((code < 0) || (code >= DIAG_LAST))
+    return DIAG_ERROR;
+  return diag_table[code].severity;
+}
+
+const char *diag_severity_name(diag_severity_t severity)
+{
+  if ((severity < DIAG_INFO) || (severity > DIAG_ERROR))
+    return "unknown";
+  return severity_name[severity];
+}
+
+const char *diag_name(diag_code_t code)
+{
+  if ((code < 0) || (code >= DIAG_LAST))
+    return "unknown";
+  return diag_table[code].name;
+}
+
+const char *diag_text(diag_code_t code)
+{
+  if ((code < 0) || (code >= DIAG_LAST))
+    return "Unknown diagnostic";
+  return diag_table[code].text;
+}
@@ -0,0 +1,426 @@
+/* diskcache.c  -  Persistent cache of equilibrium and performance    */
+/*                 results shared between processes                   */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/stat.h>
+
+#ifdef BORLAND
+#include <dir.h>
+#include <process.h>
+#define make_directory(d) mkdir(d)
+#else
+#include <unistd.h>
+#define make_directory(d) mkdir(d, 0777)
+#endif
+
+#include "diskcache.h"
+#include "cache.h"
+#include "equilibrium.h"
+#include "performance.h"
+#include "snapshot.h"
+#include "thermo.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+#define DISK_CACHE_MAGIC "CPCACHE1"
+
+/* kind of result stored */
+#define DISK_EQUILIBRIUM 0
+#define DISK_FROZEN      1
+#define DISK_SHIFTING    2
+
+/* room for the hash and the temporary suffix after the directory */
+#define DISK_NAME_MAX (FILENAME_MAX + 128)
+
+#define FNV_OFFSET  2166136261UL
+#define FNV_PRIME   16777619UL
+
+static char disk_cache_dir[FILENAME_MAX];
+static int  disk_cache_on = false;
+
+static unsigned long disk_hit  = 0;
+static unsigned long disk_miss = 0;
+
+static unsigned long checksum         = 0;
+static unsigned long checksum_version = 0; /* database_version of checksum */
+static unsigned long temp_counter     = 0;
+
+/* the settings, the counters and the checksum are shared by the
+   threads, the files are read and written unlocked */
+static mutex_t disk_lock = MUTEX_INITIALIZER;
+
+/* Key of a result: its bytes are written in the file and hashed to
+   name the file */
+typedef struct _disk_key
+{
+  int            size;
+  unsigned char *data;
+} disk_key_t;
+
+
+/* FNV-1a hash, 32 bits */
+static unsigned long fnv(unsigned long h, const void *data, size_t size)
+{
+  const unsigned char *p = (const unsigned char *) data;
+  size_t i;
+
+  for (i = 0; i < size; i++)
+  {
+    h ^= p[i];
+    h  = (h * FNV_PRIME) & 0xFFFFFFFFUL;
+  }
+  return h;
+}
+
+unsigned long database_checksum(void)
+{
+  unsigned long i;
+  int           j;
+  unsigned long h = FNV_OFFSET;
+
+  thermo_t     *t;
+  propellant_t *p;
+
+  mutex_lock(&disk_lock);
+
+  if ((checksum_version == database_version) && (checksum != 0))
+  {
+    mutex_unlock(&disk_lock);
+    return checksum;
+  }
+
+  /* field by field, the structures have padding and the unused
+     intervals are not initialized */
+  for (i = 0; i < num_thermo; i++)
+  {
+    t = thermo_list + i;
+    h = fnv(h, t->name, strlen(t->name));
+    h = fnv(h, t->id, strlen(t->id));
+    h = fnv(h, &(t->nint), sizeof(int));
+    h = fnv(h, t->elem, sizeof(t->elem));
+    h = fnv(h, t->coef, sizeof(t->coef));
+    h = fnv(h, &(t->state), sizeof(state_t));
+    h = fnv(h, &(t->weight), sizeof(double));
+
+    if (t->nint == 0)
+    {
+      h = fnv(h, &(t->temp), sizeof(float));
+      h = fnv(h, &(t->enth), sizeof(float));
+    }
+    else
+    {
+      h = fnv(h, &(t->heat), sizeof(float));
+      h = fnv(h, &(t->dho), sizeof(double));
+    }
+
+    for (j = 0; j < t->nint; j++)
+    {
+      h = fnv(h, t->range[j], sizeof(t->range[j]));
+      h = fnv(h, &(t->ncoef[j]), sizeof(int));
+      h = fnv(h, t->ex[j], sizeof(t->ex[j]));
+      h = fnv(h, t->param[j], sizeof(t->param[j]));
+    }
+  }
+
+  for (i = 0; i < num_propellant; i++)
+  {
+    p = propellant_list + i;
+    h = fnv(h, p->name, strlen(p->name));
+    h = fnv(h, p->elem, sizeof(p->elem));
+    h = fnv(h, p->coef, sizeof(p->coef));
+    h = fnv(h, &(p->heat), sizeof(float));
+    h = fnv(h, &(p->density), sizeof(float));
+  }
+
+  checksum         = h;
+  checksum_version = database_version;
+  mutex_unlock(&disk_lock);
+  return h;
+}
+
+int disk_cache_open(char *directory)
+{
+  struct stat st;
+
+  mutex_lock(&disk_lock);
+  disk_cache_on = false;
+  mutex_unlock(&disk_lock);
+
+  if (directory == NULL)
+    return SUCCESS;
+
+  if (strlen(directory) >= FILENAME_MAX)
+    return ERR_FOPEN;
+
+  if (stat(directory, &st) != 0)
+  {
+    if (make_directory(directory) != 0)
+      return ERR_FOPEN;
+  }
+
+  mutex_lock(&disk_lock);
+  strcpy(disk_cache_dir, directory);
+  disk_cache_on = true;
+  mutex_unlock(&disk_lock);
+  return SUCCESS;
+}
+
+void disk_cache_close(void)
+{
+  disk_cache_open(NULL);
+}
+
+static int disk_cache_enabled(void)
+{
+  int on;
+
+  mutex_lock(&disk_lock);
+  on = disk_cache_on;
+  mutex_unlock(&disk_lock);
+  return on;
+}
+
+void disk_cache_stats(unsigned long *hit, unsigned long *miss)
+{
+  mutex_lock(&disk_lock);
+  *hit  = disk_hit;
+  *miss = disk_miss;
+  mutex_unlock(&disk_lock);
+}
+
+static void key_append(disk_key_t *k, const void *data, size_t size)
+{
+  memcpy(k->data + k->size, data, size);
+  k->size += size;
+}
+
+/* Build the key of the problem, the composition and the targets are
+   taken from the chamber e */
+static int make_key(disk_key_t *k, int kind, equilibrium_t *e, problem_t P,
+                    int n_exit, exit_condition_t *exit_type, double *value)
+{
+  int            i;
+  int            type;
+  int            problem = P;
+  unsigned long  sum     = database_checksum();
+  double         target  = 0.0;
+  composition_t  comp;
+
+  k->size = 0;
+  k->data = (unsigned char *)
+    malloc(3 * sizeof(int) + sizeof(unsigned long)
+           + sizeof(short) * (MAX_COMP + 1) + sizeof(double) * (MAX_COMP + 2)
+           + n_exit * (sizeof(int) + sizeof(double)));
+  if (k->data == NULL)
+    return ERR_MALLOC;
+
+  if (P == TP)
+    target = e->properties.T;
+  else if (P == SP)
+    target = e->entropy;
+
+  canonical_composition(&(e->propellant), &comp);
+
+  key_append(k, &kind, sizeof(int));
+  key_append(k, &sum, sizeof(unsigned long));
+  key_append(k, &problem, sizeof(int));
+  key_append(k, &(comp.ncomp), sizeof(short));
+  key_append(k, comp.molecule, comp.ncomp * sizeof(short));
+  key_append(k, comp.coef, comp.ncomp * sizeof(double));
+  key_append(k, &(e->properties.P), sizeof(double));
+  key_append(k, &target, sizeof(double));
+  key_append(k, &n_exit, sizeof(int));
+  for (i = 0; i < n_exit; i++)
+  {
+    type = exit_type[i];
+    key_append(k, &type, sizeof(int));
+    key_append(k, value + i, sizeof(double));
+  }
+  return SUCCESS;
+}
+
+static void key_filename(disk_key_t *k, char *filename)
+{
+  /* two hashes with different offsets, 64 bits of name */
+  mutex_lock(&disk_lock);
+  sprintf(filename, "%s/%08lx%08lx.cpc", disk_cache_dir,
+          fnv(FNV_OFFSET, k->data, k->size),
+          fnv(FNV_OFFSET ^ 0x5bd1e995UL, k->data, k->size));
+  mutex_unlock(&disk_lock);
+}
+
+/* Read the n states of the key in e, the caller composition is kept.
+   Each state is a snapshot, with the warnings of its solve. */
+static int disk_read(disk_key_t *k, equilibrium_t *e, int n)
+{
+  int    i;
+  int    size;
+  int    ok;
+  char   filename[DISK_NAME_MAX];
+  char   magic[8];
+  FILE  *fd;
+
+  unsigned char *data;
+  char          *buffer;
+  equilibrium_t *states;
+  composition_t  propellant;
+  unsigned int   warnings;
+
+  key_filename(k, filename);
+
+  if ((fd = fopen(filename, "rb")) == NULL)
+    return false;
+
+  data   = (unsigned char *) malloc(k->size);
+  buffer = (char *) malloc(sizeof(equilibrium_t));
+  states = (equilibrium_t *) malloc(n * sizeof(equilibrium_t));
+
+  ok = (data != NULL) && (buffer != NULL) && (states != NULL) &&
+    (fread(magic, 8, 1, fd) == 1) &&
+    (memcmp(magic, DISK_CACHE_MAGIC, 8) == 0) &&
+    (fread(&size, sizeof(int), 1, fd) == 1) && (size == k->size) &&
+    (fread(data, size, 1, fd) == 1) && (memcmp(data, k->data, size) == 0);
+
+  /* the snapshots check their version and the loaded data */
+  for (i = 0; ok && (i < n); i++)
+  {
+    ok = (fread(&size, sizeof(int), 1, fd) == 1) &&
+      (size > 0) && (size <= (int) sizeof(equilibrium_t)) &&
+      (fread(buffer, size, 1, fd) == 1) &&
+      (fread(&warnings, sizeof(unsigned int), 1, fd) == 1) &&
+      (restore_equilibrium(states + i, buffer, size) == SUCCESS);
+    if (ok)
+      states[i].stats.warnings = warnings;
+  }
+
+  if (ok)
+  {
+    propellant = e->propellant;
+    for (i = 0; i < n; i++)
+    {
+      copy_equilibrium(e + i, states + i);
+      e[i].propellant = propellant;
+    }
+  }
+
+  fclose(fd);
+  free(data);
+  free(buffer);
+  free(states);
+  return ok;
+}
+
+/* Write the n states under a temporary name then rename it, readers
+   never see a partial file */
+static void disk_write(disk_key_t *k, equilibrium_t *e, int n)
+{
+  int   i;
+  int   ok;
+  int   size;
+  char  filename[DISK_NAME_MAX];
+  char  temp[DISK_NAME_MAX + 64];
+  char *buffer;
+  FILE *fd;
+
+  if ((buffer = (char *) malloc(sizeof(equilibrium_t))) == NULL)
+    return;
+
+  key_filename(k, filename);
+
+  mutex_lock(&disk_lock);
+  sprintf(temp, "%s.%ld.%lu.tmp", filename, (long) getpid(), temp_counter++);
+  mutex_unlock(&disk_lock);
+
+  if ((fd = fopen(temp, "wb")) == NULL)
+  {
+    free(buffer);
+    return;
+  }
+
+  ok = (fwrite(DISK_CACHE_MAGIC, 8, 1, fd) == 1) &&
+    (fwrite(&(k->size), sizeof(int), 1, fd) == 1) &&
+    (fwrite(k->data, k->size, 1, fd) == 1);
+
+  for (i = 0; ok && (i < n); i++)
+  {
+    size = save_equilibrium(e + i, buffer, sizeof(equilibrium_t));
+    ok   = (size > 0) &&
+      (fwrite(&size, sizeof(int), 1, fd) == 1) &&
+      (fwrite(buffer, size, 1, fd) == 1) &&
+      (fwrite(&(e[i].stats.warnings), sizeof(unsigned int), 1, fd) == 1);
+  }
+
+  if ((fclose(fd) != 0) || !ok || (rename(temp, filename) != 0))
+    remove(temp);
+  free(buffer);
+}
+
+/* Look up the result, compute and store it if it is missing */
+static int disk_cached(int kind, equilibrium_t *e, problem_t P, int n_exit,
+                       exit_condition_t *exit_type, double *value)
+{
+  int        err_code;
+  int        n_state = (kind == DISK_EQUILIBRIUM) ? 1 : n_exit + 2;
+  disk_key_t key;
+
+  if ((err_code = make_key(&key, kind, e, P, n_exit, exit_type, value)) < 0)
+    return err_code;
+
+  if (disk_read(&key, e, n_state))
+  {
+    mutex_lock(&disk_lock);
+    disk_hit++;
+    mutex_unlock(&disk_lock);
+    free(key.data);
+    return SUCCESS;
+  }
+
+  mutex_lock(&disk_lock);
+  disk_miss++;
+  mutex_unlock(&disk_lock);
+
+  if (kind == DISK_EQUILIBRIUM)
+    err_code = chamber_state(e, P);
+  else if (kind == DISK_FROZEN)
+    err_code = frozen_performance_multi(e, n_exit, exit_type, value);
+  else
+    err_code = shifting_performance_multi(e, n_exit, exit_type, value);
+
+  if (err_code >= 0)
+    disk_write(&key, e, n_state);
+
+  free(key.data);
+  return err_code;
+}
+
+int disk_cached_equilibrium(equilibrium_t *e, problem_t P)
+{
+  if (!disk_cache_enabled())
+    return chamber_state(e, P);
+  return disk_cached(DISK_EQUILIBRIUM, e, P, 0, NULL, NULL);
+}
+
+int disk_cached_frozen_performance(equilibrium_t *e, int n_exit,
+                                   exit_condition_t *exit_type,
+                                   double *value)
+{
+  if (!disk_cache_enabled())
+    return frozen_performance_multi(e, n_exit, exit_type, value);
+  return disk_cached(DISK_FROZEN, e, HP, n_exit, exit_type, value);
+}
+
+int disk_cached_shifting_performance(equilibrium_t *e, int n_exit,
+                                     exit_condition_t *exit_type,
+                                     double *value)
+{
+  if (!disk_cache_enabled())
+    return shifting_performance_multi(e, n_exit, exit_type, value);
+  return disk_cached(DISK_SHIFTING, e, HP, n_exit, exit_type, value);
+}
@@ -20,6 +20,11 @@
 #include "conversion.h"
 #include "compat.h"
 #include "return.h"
+#include "timer.h"
+#include "trace.h"
+#include "timeline.h"
+#include "diag.h"
+#include "budget.h"
 
 #include "thermo.h" /* thermodynamics function */
 
@@ -41,6 +46,58 @@ double product_molar_mass(equilibrium_t *e)
   return (1/e->itn.n);
 }
 
+int product_columns(equilibrium_t *e, int n_species, short *species)
+{
+  int i, j;
+  int n_gas = __min(e->product.n[GAS], n_species);
+  
+  for (j = 0; j < n_species; j++)
+    species[j] = -1;
+  for (i = 0; i < n_gas; i++)
+    species[i] = e->product.species[GAS][i];
+  for (i = 0; (i < e->product.n_condensed) && (n_gas + i < n_species); i++)
+    species[n_gas + i] = e->product.species[CONDENSED][i];
+
+  return e->product.n[GAS] + e->product.n_condensed;
+}
+
+int product_molar_fractions(equilibrium_t *e, int n_species, short *species,
+                            double *x)
+{
+  int    i, j;
+  int    n_gas;
+  double mol_g;
+
+  product_t *p = &(e->product);
+
+  n_gas = __min(p->n[GAS], n_species);
+  
+  mol_g = e->itn.n;
+  for (i = 0; i < p->n[CONDENSED]; i++)
+    mol_g += p->coef[CONDENSED][i];
+  
+  for (j = 0; j < n_species; j++)
+    x[j] = 0.0;
+  
+  /* the gaseous species never move in the product list */
+  for (i = 0; i < n_gas; i++)
+    x[i] = p->coef[GAS][i] / mol_g;
+
+  /* but the condensed one are reordered when included or removed */
+  for (i = 0; i < p->n[CONDENSED]; i++)
+  {
+    for (j = n_gas; j < n_species; j++)
+    {
+      if (species[j] == p->species[CONDENSED][i])
+      {
+        x[j] = p->coef[CONDENSED][i] / mol_g;
+        break;
+      }
+    }
+  }
+  return SUCCESS;
+}
+
 int list_element(equilibrium_t *e)
 {
   int n = 0;
@@ -49,6 +106,10 @@ int list_element(equilibrium_t *e)
 
   composition_t *prop = &(e->propellant);
   product_t     *prod = &(e->product);
+
+  TIMER_VAR(timer)
+
+  TIMER_START(timer);
   
   /* reset the lement vector to -1 */
   reset_element_list(e);
@@ -73,8 +134,7 @@ int list_element(equilibrium_t *e)
           {
             if (n == MAX_ELEMENT)
             {
-              fprintf(errorfile, "Maximum of %d elements. Abort.\n",
-                      MAX_ELEMENT);
+              diag_raise(e, DIAG_MAX_ELEMENT, MAX_ELEMENT);
             }
             prod->element[n] = t;
             n++;
@@ -86,7 +146,8 @@ int list_element(equilibrium_t *e)
   }
   prod->n_element      = n;
   prod->element_listed = 1;
-  
+
+  TIMER_STOP(timer, TIMER_LIST);
   return n;
 }
 
@@ -113,6 +174,10 @@ int list_product(equilibrium_t *e)
   int ok = 1;
 
   product_t    *prod = &(e->product);
+
+  TIMER_VAR(timer)
+
+  TIMER_START(timer);
   
   /* reset the product to zero */
   prod->n[GAS]       = 0;
@@ -146,10 +211,8 @@ int list_product(equilibrium_t *e)
       
       if ((prod->n[GAS] > MAX_PRODUCT) || (prod->n[CONDENSED] > MAX_PRODUCT))
       {
-        fprintf(errorfile,
-                "Error: Maximum of %d differents product reach.\n",
-                MAX_PRODUCT);
-        fprintf(errorfile, "       Change MAX_PRODUCT and recompile!\n");
+        diag_raise(e, DIAG_MAX_PRODUCT, MAX_PRODUCT);
+        TIMER_STOP(timer, TIMER_LIST);
         return ERR_TOO_MUCH_PRODUCT;
       }
        
@@ -178,7 +241,8 @@ int list_product(equilibrium_t *e)
     e->product.coef[CONDENSED][i] = 0;
 
   e->product.product_listed = 1;
-  
+
+  TIMER_STOP(timer, TIMER_LIST);
   return n;
 
 
@@ -213,6 +277,8 @@ int initialize_equilibrium(equilibrium_t *e)
   
   e->product.isequil        = false;
   e->product.element_listed = 0; /* the element haven't been listed */
+
+  memset(&(e->stats), 0, sizeof(solver_stats_t));
   
   /* initialize the product */
   return initialize_product(&(e->product));
@@ -220,12 +286,79 @@ int initialize_equilibrium(equilibrium_t *e)
 }
 
 
+int clear_equilibrium(equilibrium_t *e)
+{
+  int i;
+  int n_gas;
+  int n_condensed;
+  int n_species;
+
+  product_t *p = &(e->product);
+
+  n_gas       = __min(__max(p->n[GAS], 0), MAX_PRODUCT);
+  n_condensed = __min(__max(__max(p->n_condensed, p->n[CONDENSED]), 0),
+                      MAX_PRODUCT);
+  n_species   = __min(n_gas + n_condensed, MAX_PRODUCT);
+
+  /* reset_element_list write the whole element list */
+  memset(p->element, 0, MAX_ELEMENT * sizeof(short));
+  for (i = 0; i < p->n_element && i < MAX_ELEMENT; i++)
+    memset(p->A[i], 0, n_gas * sizeof(unsigned short));
+
+  memset(p->species[GAS], -1, n_gas * sizeof(short));
+  memset(p->species[CONDENSED], -1, n_condensed * sizeof(short));
+  memset(p->coef[GAS], 0, n_gas * sizeof(double));
+  memset(p->coef[CONDENSED], 0, n_condensed * sizeof(double));
+  memset(e->itn.ln_nj, 0, n_species * sizeof(double));
+  memset(e->itn.delta_ln_nj, 0, n_species * sizeof(double));
+
+  p->n_element       = 0;
+  p->n[GAS]          = 0;
+  p->n[CONDENSED]    = 0;
+  p->n_condensed     = 0;
+  p->element_listed  = 0;
+  p->product_listed  = 0;
+  p->isequil         = false;
+
+  e->equilibrium_ok = false;
+  e->properties_ok  = false;
+  e->performance_ok = false;
+  e->entropy        = 0.0;
+
+  e->itn.n          = 0.0;
+  e->itn.ln_n       = 0.0;
+  e->itn.sumn       = 0.0;
+  e->itn.delta_ln_n = 0.0;
+  e->itn.delta_ln_T = 0.0;
+
+  memset(&(e->propellant), 0, sizeof(composition_t));
+  memset(&(e->properties), 0, sizeof(equilib_prop_t));
+  memset(&(e->performance), 0, sizeof(performance_prop_t));
+  memset(&(e->stats), 0, sizeof(solver_stats_t));
+
+  return 0;
+}
+
 int copy_equilibrium(equilibrium_t *dest, equilibrium_t *src)
 {
   memcpy(dest, src, sizeof(equilibrium_t));
   return 0;
 }
 
+int solver_stats_add(solver_stats_t *total, solver_stats_t *s)
+{
+  total->iterations += s->iterations;
+  total->restarts   += s->restarts;
+  total->lu         += s->lu;
+  total->singular   += s->singular;
+  total->inserted   += s->inserted;
+  total->removed    += s->removed;
+  total->lambda      = s->lambda;
+  total->time       += s->time;
+  total->warnings   |= s->warnings;
+  return 0;
+}
+
 int reset_element_list(equilibrium_t *e)
 {
   int i;
@@ -701,7 +834,7 @@ int remove_condensed(short *size, short *n, equilibrium_t *e)
     /* if a condensed have negative coefficient, we should remove it */
     if (p->coef[CONDENSED][i] <= 0.0)
     {
-      if (global_verbose > 1)
+      if (VERBOSE(2))
       {
         fprintf(outputfile,
                 "%s should be remove, negative concentration.\n\n", 
@@ -718,6 +851,8 @@ int remove_condensed(short *size, short *n, equilibrium_t *e)
       p->species[CONDENSED][ p->n[CONDENSED] - 1 ] = pos;
         
       (p->n[CONDENSED])--;
+      e->stats.removed++;
+      TIMELINE_MARK("remove_condensed", pos);
       
       //(*size)--; /* reduce the size of the matrix */
       r = 1;
@@ -757,7 +892,7 @@ int remove_condensed(short *size, short *n, equilibrium_t *e)
                                                   pr->T)) > 50.0)
           {
             /* replace the molecule */
-            if (global_verbose > 1)
+            if (VERBOSE(2))
             {
               fprintf(outputfile, "%s should be replace by %s\n\n",
                       (thermo_list + p->species[CONDENSED][i])->name,
@@ -767,12 +902,15 @@ int remove_condensed(short *size, short *n, equilibrium_t *e)
             pos = p->species[CONDENSED][i];
             p->species[CONDENSED][i] = p->species[CONDENSED][j];
             p->species[CONDENSED][j] = pos;
-            
+
+            e->stats.removed++;
+            e->stats.inserted++;
+            TIMELINE_MARK("replace_condensed", p->species[CONDENSED][i]);
           }
           else
           {
             /* add the molecule */
-            if (global_verbose > 1)
+            if (VERBOSE(2))
             {
               fprintf(outputfile, "%s should be add with %s\n\n",
                       (thermo_list + p->species[CONDENSED][i])->name,
@@ -786,7 +924,8 @@ int remove_condensed(short *size, short *n, equilibrium_t *e)
             p->species[CONDENSED][i] = pos;
     
             p->n[CONDENSED]++;
-
+            e->stats.inserted++;
+            TIMELINE_MARK("add_condensed", pos);
           }
           
 
@@ -844,7 +983,7 @@ int include_condensed(short *size, short *n, equilibrium_t *e,
   if (!(j == -1))
   {
     
-    if (global_verbose > 1)
+    if (VERBOSE(2))
     { 
       fprintf(outputfile, "%s should be include\n\n", 
               (thermo_list + e->product.species[CONDENSED][j])->name );
@@ -858,12 +997,50 @@ int include_condensed(short *size, short *n, equilibrium_t *e,
     p->species[CONDENSED][j] = pos;
     
     p->n[CONDENSED]++;
+    e->stats.inserted++;
+    TIMELINE_MARK("include_condensed",
+                  p->species[CONDENSED][p->n[CONDENSED] - 1]);
   
     return 1;
   }
   return 0;
 }
 
+/* Verbose output of new_approximation, out of the iteration */
+static void print_correction(equilibrium_t *e, double lambda,
+                             double lambda1, double lambda2)
+{
+  int i;
+
+  product_t       *p  = &(e->product);
+  iteration_var_t *it = &(e->itn);
+
+  fprintf(outputfile,
+          "lambda  = %.10f\nlambda1 = %.10f\nlambda2 = %.10f\n\n",
+          lambda, lambda1, lambda2);
+  fprintf(outputfile, "%-19s  nj \t\t  ln_nj_n \t  Delta ln(nj)\n", "");
+
+  for (i = 0; i < p->n[GAS]; i++)
+  {
+    fprintf(outputfile, "%-19s % .4e \t % .4e \t % .4e\n",
+            (thermo_list + p->species[GAS][i])->name,
+            p->coef[GAS][i], it->ln_nj[i], it->delta_ln_nj[i]);
+  }
+}
+
+static void print_condensed_coef(equilibrium_t *e)
+{
+  int i;
+
+  product_t *p = &(e->product);
+
+  for (i = 0; i < p->n[CONDENSED]; i++)
+  {
+    fprintf(outputfile, "%-19s % .4e\n",
+            (thermo_list + p->species[CONDENSED][i])->name,
+            p->coef[CONDENSED][i]);
+  }
+}
 
 int new_approximation(equilibrium_t *e, double *sol, problem_t P)
 {
@@ -926,21 +1103,10 @@ int new_approximation(equilibrium_t *e, double *sol, problem_t P)
   lambda1 = 2.0 / lambda1;
   
   lambda = _min(1.0, lambda1, lambda2);
+  e->stats.lambda = lambda;
   
-  if (global_verbose > 3)
-  {
-    fprintf(outputfile,
-            "lambda  = %.10f\nlambda1 = %.10f\nlambda2 = %.10f\n\n",
-            lambda, lambda1, lambda2);
-    fprintf(outputfile, "%-19s  nj \t\t  ln_nj_n \t  Delta ln(nj)\n", "");
-    
-    for (i = 0; i < p->n[GAS]; i++)
-    {
-      fprintf(outputfile, "%-19s % .4e \t % .4e \t % .4e\n", 
-              (thermo_list + p->species[GAS][i])->name, 
-              p->coef[GAS][i], it->ln_nj[i], it->delta_ln_nj[i]);
-    }
-  }
+  if (VERBOSE(4))
+    print_correction(e, lambda, lambda1, lambda2);
 
   it->sumn = 0.0;
   
@@ -968,21 +1134,14 @@ int new_approximation(equilibrium_t *e, double *sol, problem_t P)
       lambda*sol[p->n_element + i];     
   }
 
-  if (global_verbose > 3)
-  {
-    for (i = 0; i < p->n[CONDENSED]; i++)
-    {
-      fprintf(outputfile, "%-19s % .4e\n", 
-              (thermo_list + p->species[CONDENSED][i])->name, 
-              p->coef[CONDENSED][i]);
-    }
-  }
+  if (VERBOSE(4))
+    print_condensed_coef(e);
     
   /* new value of T */
   if (P != TP)
     pr->T = exp( log(pr->T) + lambda * it->delta_ln_T);
       
-  if (global_verbose > 2)
+  if (VERBOSE(3))
     fprintf(outputfile, "Temperature: %f\n", pr->T);
       
   /* new value of n */
@@ -1025,7 +1184,7 @@ bool convergence(equilibrium_t *e, double *sol)
   return true;
 }
 
-int equilibrium(equilibrium_t *equil, problem_t P)
+static int solve_equilibrium(equilibrium_t *equil, problem_t P)
 {
   int err_code;
   
@@ -1038,6 +1197,12 @@ int equilibrium(equilibrium_t *equil, problem_t P)
   bool stop           = false;
   bool gas_reinserted = false;
   bool solution_ok    = false;
+  bool exhausted      = false;
+
+  double start = timer_now();
+
+  TIMELINE_VAR(iteration)
+  TIMELINE_VAR(lu)
 
   product_t *p  = &(equil->product);
   
@@ -1048,8 +1213,11 @@ int equilibrium(equilibrium_t *equil, problem_t P)
   if (P == TP)
     roff = 1;
 
-  /* initial temperature for assign enthalpy, entropy/pressure */
-  if ( P != TP)
+  memset(&(equil->stats), 0, sizeof(solver_stats_t));
+
+  /* initial temperature for assign enthalpy, entropy/pressure,
+     the temperature of a previous equilibrium is a better estimate */
+  if ( P != TP && (!(equil->product.isequil) || equil->properties.T <= 0.0))
     equil->properties.T = ESTIMATED_T;
 
   
@@ -1100,6 +1268,15 @@ int equilibrium(equilibrium_t *equil, problem_t P)
   /* main loop */
   for (k = 0; k < ITERATION_MAX; k++)
   {
+    /* stop on the last approximation if the work budget is spent */
+    if (budget_iteration())
+    {
+      exhausted = true;
+      break;
+    }
+    TIMELINE_START(iteration);
+    equil->stats.iterations++;
+
     /* Initially we haven't a good solution */
     solution_ok = false;
 
@@ -1107,28 +1284,36 @@ int equilibrium(equilibrium_t *equil, problem_t P)
     {      
       fill_equilibrium_matrix(matrix, equil, P);
       
-      if (global_verbose > 2)
+      if (VERBOSE(3))
       {
         fprintf(outputfile, "Iteration %d\n", k+1);
         NUM_print_matrix(matrix, size);
       }
-      if (NUM_lu(matrix, sol, size) == -1) /* solve the matrix */
+      equil->stats.lu++;
+      TIMELINE_START(lu);
+      err_code = NUM_lu(matrix, sol, size); /* solve the matrix */
+      TIMELINE_SPAN(lu, "lu", size);
+      if (err_code != 0) /* NO_SOLUTION, the iteration go on */
       {
-        /* the matrix have no unique solution */
-        fprintf(outputfile,
-                "The matrix is singular, removing excess condensed.\n");
-          
-        /* Try removing excess condensed */
+        diag_raise(equil, DIAG_SINGULAR, size);
+        equil->stats.singular++;
+      }
+
+      if (err_code == -1)
+      {
+
+        /* the matrix have no unique solution,
+           try removing excess condensed */
         if (!remove_condensed(&size, &(equil->product.n_condensed), equil))
         {
           if (gas_reinserted)
           {
-            fprintf(errorfile, "ERROR: No convergence, don't trust results\n");
+            diag_raise(equil, DIAG_NO_CONVERGENCE, equil->stats.iterations);
             /* finish the main loop */
             stop = true;
             break;
           }
-          fprintf(errorfile, "None remove. Try reinserting remove gaz\n");
+          diag_raise(equil, DIAG_GAS_REINSERTED, equil->stats.iterations);
           for (i = 0; i < equil->product.n[GAS]; i++)
           {
             /* It happen that some species were eliminated in the
@@ -1146,6 +1331,8 @@ int equilibrium(equilibrium_t *equil, problem_t P)
         
         /* Restart the loop counter to zero for a new loop */
         k = -1;
+        equil->stats.restarts++;
+        budget_restart();
       }
       else /* There is a solution */
       {
@@ -1153,7 +1340,7 @@ int equilibrium(equilibrium_t *equil, problem_t P)
       }
     }
       
-    if (global_verbose > 2)
+    if (VERBOSE(3))
     {
       NUM_print_vec(sol, size);    /* print the solution vector */
       fprintf(outputfile, "\n");
@@ -1169,7 +1356,7 @@ int equilibrium(equilibrium_t *equil, problem_t P)
     {
       convergence_ok = true;
 
-      if (global_verbose > 0)
+      if (VERBOSE(1))
       {
         fprintf(outputfile,
                 "The solution converge in %-2d iterations (%.2f degK)\n",
@@ -1209,19 +1396,23 @@ int equilibrium(equilibrium_t *equil, problem_t P)
         sol = (double *) malloc (sizeof(double) * size);
           
         /* haven't converge yet */
-        convergence_ok = false;    
+        convergence_ok = false;
+        equil->stats.restarts++;
+        budget_restart();
       }
         
       /* reset the loop counter to compute a new equilibrium */
       k = -1;
     }
-    else if (global_verbose > 2)
+    else if (VERBOSE(3))
     {
       fprintf(outputfile, "The solution doesn't converge\n\n");
       /* ?? */
       /*remove_condensed(&size, &n_condensed, equil); */
     }
 
+    TIMELINE_SPAN(iteration, "newton", equil->stats.iterations);
+
     if (convergence_ok || stop)
     {
       /* when the solution have converge, we could get out of the
@@ -1237,8 +1428,19 @@ int equilibrium(equilibrium_t *equil, problem_t P)
 
   free (sol);
   free (matrix);
-  
-  if (k == ITERATION_MAX)
+
+  equil->stats.time = timer_now() - start;
+
+  if (exhausted)
+  {
+    /* not an equilibrium, only the properties of the partial
+       composition */
+    diag_raise(equil, DIAG_BUDGET, equil->stats.iterations);
+    equil->equilibrium_ok = false;
+    compute_thermo_properties(equil);
+    return ERR_BUDGET;
+  }
+  else if (k == ITERATION_MAX)
   {
     //fprintf(outputfile, "\n");
     //fprintf(outputfile, "Maximum number of %d iterations attain\n",
@@ -1259,8 +1461,37 @@ int equilibrium(equilibrium_t *equil, problem_t P)
 
   compute_thermo_properties(equil); 
   derivative(equil);
+
+  equil->stats.time = timer_now() - start;
   
   return SUCCESS;
 }
 
+int equilibrium(equilibrium_t *equil, problem_t P)
+{
+  int err_code;
+  int traced;
+
+  TIMELINE_VAR(timeline)
+
+  TIMELINE_START(timeline);
+  traced   = trace_begin(TRACE_EQUILIBRIUM, equil, P, 0, NULL, NULL);
+  err_code = solve_equilibrium(equil, P);
+  trace_end(traced);
+  TIMELINE_SPAN(timeline, "equilibrium", P);
+  return err_code;
+}
+
+int chamber_state(equilibrium_t *equil, problem_t P)
+{
+  int err_code;
+
+  TIMER_VAR(timer)
+
+  TIMER_START(timer);
+  err_code = equilibrium(equil, P);
+  TIMER_STOP(timer, TIMER_CHAMBER);
+  return err_code;
+}
+
 
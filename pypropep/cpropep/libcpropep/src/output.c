@@ -0,0 +1,276 @@
+/* output.c  -  CSV and JSON Lines writers of the results             */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "output.h"
+#include "equilibrium.h"
+#include "thermo.h"
+
+#include "compat.h"
+#include "return.h"
+
+static const char *station_name[] = { "chamber", "throat", "exit" };
+
+#define OUTPUT_NVAR 19
+
+static const char *column_name[OUTPUT_NVAR] = {
+  "P", "T", "H", "U", "G", "S", "Cp", "Cv", "M", "dV_P", "dV_T",
+  "gamma", "Vson", "ae_at", "a_dotm", "cstar", "cf", "Ivac", "Isp"
+};
+
+/* the performance columns, they are not written at the chamber */
+#define OUTPUT_FIRST_PERFORMANCE 13
+
+int output_open(output_t *o, FILE *fd, output_format_t format)
+{
+  if ((format != OUTPUT_CSV) && (format != OUTPUT_JSONL))
+    return -1;
+
+  o->fd             = fd;
+  o->format         = format;
+  o->header_written = false;
+  o->length         = 0;
+  return SUCCESS;
+}
+
+int output_format(const char *name)
+{
+  if (strcmp(name, "text") == 0)
+    return OUTPUT_TEXT;
+  else if (strcmp(name, "csv") == 0)
+    return OUTPUT_CSV;
+  else if ((strcmp(name, "jsonl") == 0) || (strcmp(name, "json") == 0))
+    return OUTPUT_JSONL;
+  return -1;
+}
+
+int output_flush(output_t *o)
+{
+  if (o->length > 0)
+  {
+    if (fwrite(o->buffer, 1, o->length, o->fd) != o->length)
+    {
+      o->length = 0;
+      return ERROR;
+    }
+    o->length = 0;
+  }
+  return SUCCESS;
+}
+
+static void put_string(output_t *o, const char *s, size_t len)
+{
+  if (o->length + len > OUTPUT_BUFFER)
+  {
+    output_flush(o);
+
+    /* too long to be buffered */
+    if (len > OUTPUT_BUFFER)
+    {
+      fwrite(s, 1, len, o->fd);
+      return;
+    }
+  }
+  memcpy(o->buffer + o->length, s, len);
+  o->length += len;
+}
+
+static void put(output_t *o, const char *s)
+{
+  put_string(o, s, strlen(s));
+}
+
+/* A JSON string, with the quotes and the backslashes escaped */
+static void put_quoted(output_t *o, const char *s)
+{
+  put(o, "\"");
+  for (; *s != '\0'; s++)
+  {
+    if (*s == '"')
+      put(o, "\\\"");
+    else if (*s == '\\')
+      put(o, "\\\\");
+    else
+      put_string(o, s, 1);
+  }
+  put(o, "\"");
+}
+
+/* A value that is not finite is left empty (null in JSON) */
+static void put_double(output_t *o, double x)
+{
+  char tmp[32];
+
+  if ((x != x) || (x - x != 0.0))
+  {
+    if (o->format == OUTPUT_JSONL)
+      put(o, "null");
+    return;
+  }
+  sprintf(tmp, "%.10g", x);
+  put(o, tmp);
+}
+
+static void station_values(equilibrium_t *e, double *v)
+{
+  v[0]  = e->properties.P;
+  v[1]  = e->properties.T;
+  v[2]  = e->properties.H;
+  v[3]  = e->properties.U;
+  v[4]  = e->properties.G;
+  v[5]  = e->properties.S;
+  v[6]  = e->properties.Cp;
+  v[7]  = e->properties.Cv;
+  v[8]  = e->properties.M;
+  v[9]  = e->properties.dV_P;
+  v[10] = e->properties.dV_T;
+  v[11] = e->properties.Isex;
+  v[12] = e->properties.Vson;
+  v[13] = e->performance.ae_at;
+  v[14] = e->performance.a_dotm;
+  v[15] = e->performance.cstar;
+  v[16] = e->performance.cf;
+  v[17] = e->performance.Ivac;
+  v[18] = e->performance.Isp;
+}
+
+static void put_fraction(output_t *o, int sp, double x, int *first)
+{
+  char tmp[32];
+
+  if (!(x > 0.0))
+    return;
+
+  if (!*first)
+    put(o, (o->format == OUTPUT_CSV) ? " " : ", ");
+  *first = false;
+
+  sprintf(tmp, "%.6e", x);
+  if (o->format == OUTPUT_CSV)
+  {
+    put(o, (thermo_list + sp)->name);
+    put(o, "=");
+  }
+  else
+  {
+    put_quoted(o, (thermo_list + sp)->name);
+    put(o, ": ");
+  }
+  put(o, tmp);
+}
+
+static void put_composition(output_t *o, equilibrium_t *e)
+{
+  int    i;
+  int    first = true;
+  double mol_g = e->itn.n;
+
+  product_t *p = &(e->product);
+
+  for (i = 0; i < p->n[CONDENSED]; i++)
+    mol_g += p->coef[CONDENSED][i];
+
+  for (i = 0; i < p->n[GAS]; i++)
+    put_fraction(o, p->species[GAS][i], p->coef[GAS][i] / mol_g, &first);
+  for (i = 0; i < p->n[CONDENSED]; i++)
+    put_fraction(o, p->species[CONDENSED][i],
+                 p->coef[CONDENSED][i] / mol_g, &first);
+}
+
+static void csv_header(output_t *o)
+{
+  int i;
+
+  put(o, "case,type,station");
+  for (i = 0; i < OUTPUT_NVAR; i++)
+  {
+    put(o, ",");
+    put(o, column_name[i]);
+  }
+  put(o, ",warnings,composition\n");
+  o->header_written = true;
+}
+
+int output_record(output_t *o, int n_case, const char *case_type,
+                  equilibrium_t *e, short npt)
+{
+  int    i, j;
+  char   tmp[32];
+  double v[OUTPUT_NVAR];
+
+  if ((o->format == OUTPUT_CSV) && !o->header_written)
+    csv_header(o);
+
+  for (i = 0; i < npt && i < 3; i++)
+  {
+    station_values(e + i, v);
+    sprintf(tmp, "%d", n_case);
+
+    if (o->format == OUTPUT_CSV)
+    {
+      put(o, tmp);
+      put(o, ",");
+      put(o, case_type);
+      put(o, ",");
+      put(o, station_name[i]);
+      for (j = 0; j < OUTPUT_NVAR; j++)
+      {
+        put(o, ",");
+        if ((i > 0) || (j < OUTPUT_FIRST_PERFORMANCE))
+          put_double(o, v[j]);
+      }
+      sprintf(tmp, ",%u,\"", e[i].stats.warnings);
+      put(o, tmp);
+      put_composition(o, e + i);
+      put(o, "\"\n");
+    }
+    else
+    {
+      put(o, "{\"case\": ");
+      put(o, tmp);
+      put(o, ", \"type\": ");
+      put_quoted(o, case_type);
+      put(o, ", \"station\": \"");
+      put(o, station_name[i]);
+      put(o, "\"");
+      for (j = 0; j < OUTPUT_NVAR; j++)
+      {
+        put(o, ", \"");
+        put(o, column_name[j]);
+        put(o, "\": ");
+        if ((i > 0) || (j < OUTPUT_FIRST_PERFORMANCE))
+          put_double(o, v[j]);
+        else
+          put(o, "null");
+      }
+      sprintf(tmp, ", \"warnings\": %u", e[i].stats.warnings);
+      put(o, tmp);
+      put(o, ", \"composition\": {");
+      put_composition(o, e + i);
+      put(o, "}}\n");
+    }
+  }
+  return SUCCESS;
+}
+
+int output_error(output_t *o, int n_case, const char *case_type,
+                 const char *message)
+{
+  char tmp[32];
+
+  if (o->format != OUTPUT_JSONL)
+    return -1;
+
+  sprintf(tmp, "%d", n_case);
+  put(o, "{\"case\": ");
+  put(o, tmp);
+  put(o, ", \"type\": ");
+  put_quoted(o, case_type);
+  put(o, ", \"error\": ");
+  put_quoted(o, message);
+  put(o, "}\n");
+  return SUCCESS;
+}
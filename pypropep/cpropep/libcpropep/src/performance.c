@@ -10,8 +10,10 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <string.h>
 
 #include "performance.h"
+#include "cache.h"
 #include "derivative.h"
 #include "print.h"
 #include "equilibrium.h"
@@ -20,14 +22,25 @@
 #include "compat.h"
 #include "return.h"
 #include "thermo.h"
+#include "conversion.h"
+#include "timer.h"
+#include "trace.h"
+#include "timeline.h"
+#include "diag.h"
+#include "budget.h"
 
 #define TEMP_ITERATION_MAX  8
-#define PC_PT_ITERATION_MAX 5
-#define PC_PE_ITERATION_MAX 6
+#define PC_PT_ITERATION_MAX 8
+#define PC_PT_TOLERANCE     0.4e-4 /* |u^2 - a^2|/u^2 at the throat */
+#define PC_PE_ITERATION_MAX 10
+#define WARM_START_RATIO    4.0    /* of Ae/At, from the previous exit */
+#define PC_PE_TOLERANCE     1.0e-6 /* ln(Ae/At) or its Newton step at the exit */
+#define PC_PE_STEP_RESIDUAL 1.0e-3 /* ln(Ae/At) accepted on a small step   */
 
 
-double compute_temperature(equilibrium_t *e, double pressure,
-                           double p_entropy);
+double compute_temperature(equilibrium_t *e, equilibrium_t *st,
+                           double pressure, double p_entropy,
+                           double temperature);
 
 
 /* Entropy of the product at the exit pressure and temperature */
@@ -56,17 +69,16 @@ double product_enthalpy_exit(equilibrium_t *e, double temp)
 }
     
 /* The temperature could be found by entropy conservation with a
-   specified pressure */
-double compute_temperature(equilibrium_t *e, double pressure, double p_entropy)
+   specified pressure. The iteration start from the given temperature,
+   the station st is warned if it do not converge. */
+double compute_temperature(equilibrium_t *e, equilibrium_t *st,
+                           double pressure, double p_entropy,
+                           double temperature)
 {
   int i = 0;
 
   double delta_lnt;
-  double temperature;
 
-  /* The first approximation is the chamber temperature */
-  temperature = e->properties.T;
-  
   do
   {
     delta_lnt = (p_entropy  - product_entropy_exit(e, pressure, temperature))
@@ -79,217 +91,84 @@ double compute_temperature(equilibrium_t *e, double pressure, double p_entropy)
   } while (fabs(delta_lnt) >= 0.5e-4 && i < TEMP_ITERATION_MAX);
 
   if (i == TEMP_ITERATION_MAX)
-  {
-    fprintf(errorfile,
-       "Temperature do not converge in %d iterations. Don't thrust results.\n",
-            TEMP_ITERATION_MAX);
-  }
+    diag_raise(st, DIAG_TEMPERATURE, TEMP_ITERATION_MAX);
   
   return temperature;
 }
 
-int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
-                       double value)
+/* Initial estimate of ln(Pc/Pe) for an area ratio exit condition */
+static int exit_pressure_estimate(exit_condition_t exit_type, double ae_at,
+                                  double pc_pt, double isex,
+                                  double *log_pc_pe)
 {
-  int err_code;
-  
-  short i;
-
-  double sound_velocity;
-  double flow_velocity;
-  double pc_pt;            /* Chamber pressure / Throat pressure */
-  double pc_pe;            /* Chamber pressure / Exit pressure   */
-  double log_pc_pe;        /* log(pc_pe)                         */
-  double ae_at;            /* Exit aera / Throat aera            */
-  double cp_cv;
-  double chamber_entropy;
-  double exit_pressure = 0;
-  
-  equilibrium_t *t  = e + 1; /* throat equilibrium */
-  equilibrium_t *ex = e + 2; /* exit equilibrium   */
-  
-  /* find the equilibrium composition in the chamber */
-  if (!(e->product.isequil))
-  {
-    if ((err_code = equilibrium(e, HP)) != SUCCESS)
+  if (exit_type == SUPERSONIC_AREA_RATIO)
+  {   
+    if ((ae_at > 1.0) && (ae_at < 2.0))
     {
-      fprintf(outputfile,
-              "No equilibrium, performance evaluation aborted.\n");
-      return err_code;
+      *log_pc_pe = log(pc_pt) + sqrt (3.294*pow(log(ae_at),2) +
+                                      1.535*log(ae_at));
+    }
+    else if (ae_at >= 2.0)
+    {
+      *log_pc_pe = isex + 1.4 * log(ae_at);
+    }
+    else
+    {
+      /* out of range ( < 1.0 ), reported by the caller */
+      return ERR_AERA_RATIO;
     }
   }
-
-  /* Simplification due to frozen equilibrium */
-  e->properties.dV_T =  1.0;
-  e->properties.dV_P = -1.0;
-  
-  chamber_entropy  = product_entropy(e);
-  
-  /* begin computation of throat caracteristic */
-  copy_equilibrium(t, e);
-  
-  cp_cv = e->properties.Cp/e->properties.Cv;
-
-  /* first estimate of Pc/Pt */
-  pc_pt = pow (cp_cv/2 + 0.5, cp_cv/(cp_cv - 1));
-
-  i = 0;
-  do
-  {
-   
-    t->properties.T = compute_temperature(t, e->properties.P/pc_pt,
-                                          chamber_entropy);
-
-    compute_thermo_properties(t);
-    
-    sound_velocity = sqrt(1000 * e->itn.n * R * t->properties.T *
-                          t->properties.Isex);
-    
-    flow_velocity = sqrt(2000*(product_enthalpy(e)*R*e->properties.T -
-                               product_enthalpy_exit(e, t->properties.T)*
-                               R*t->properties.T));
-    
-    pc_pt = pc_pt / ( 1 + ((pow(flow_velocity, 2) - pow(sound_velocity, 2))
-                           /(1000*(t->properties.Isex + 1)*
-                             t->itn.n * R *t->properties.T)));
-    i++;
-  } while ((fabs((pow(flow_velocity, 2) - pow(sound_velocity, 2))
-                 /pow(flow_velocity, 2)) > 0.4e-4) &&
-           (i < PC_PT_ITERATION_MAX));
-
-  if (i == PC_PT_ITERATION_MAX)
-  {
-    fprintf(errorfile,
-    "Throat pressure do not converge in %d iterations. Don't thrust results\n",
-            PC_PT_ITERATION_MAX);
-  }
-  
-  //printf("%d iterations to evaluate throat pressure.\n", i);
-  
-  t->properties.P    = e->properties.P/pc_pt;
-  t->performance.Isp = t->properties.Vson = sound_velocity;
-
-  /* Now compute exit properties */ 
-  copy_equilibrium(ex, e);
-
-  if (exit_type == PRESSURE)
-  {
-    exit_pressure = value;
-  }
-  else 
+  else if (exit_type == SUBSONIC_AREA_RATIO)
   {
-    ae_at = value;
-    
-    /* Initial estimate of pressure ratio */
-    if (exit_type == SUPERSONIC_AREA_RATIO)
-    {   
-      if ((ae_at > 1.0) && (ae_at < 2.0))
-      {
-        log_pc_pe = log(pc_pt) + sqrt (3.294*pow(ae_at,2) + 1.535*log(ae_at));
-      }
-      else if (ae_at >= 2.0)
-      {
-        log_pc_pe = t->properties.Isex + 1.4 * log(ae_at);
-      }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
-      }
-    }
-    else if (exit_type == SUBSONIC_AREA_RATIO)
+    if ((ae_at > 1.0) && (ae_at < 1.09))
     {
-      if ((ae_at > 1.0) && (ae_at < 1.09))
-      {
-        log_pc_pe = 0.9 * log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
-      }
-      else if (ae_at >= 1.09)
-      {
-        log_pc_pe = log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
-      }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
-      }
+      *log_pc_pe = 0.9 * log(pc_pt) /
+        (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
     }
-    else
+    else if (ae_at >= 1.09)
     {
-      return ERR_RATIO_TYPE;
+      *log_pc_pe = log(pc_pt) /
+        (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
     }
-    
-
-    /* Improved the estimate */
-    i = 0;
-    do
-    {      
-      pc_pe            = exp(log_pc_pe);
-      ex->properties.P = exit_pressure   = e->properties.P/pc_pe;
-      ex->properties.T = compute_temperature(e, exit_pressure,
-                                             chamber_entropy);
-      
-      compute_thermo_properties(ex);
-    
-      sound_velocity = sqrt(1000 * ex->itn.n * R * ex->properties.T *
-                            ex->properties.Isex);
-    
-      ex->performance.Isp =
-        flow_velocity = sqrt(2000*(product_enthalpy(e)*R*e->properties.T -
-                                   product_enthalpy_exit(e, ex->properties.T)*
-                                   R*ex->properties.T));
-      
-      ex->performance.ae_at =
-        (ex->properties.T * t->properties.P * t->performance.Isp) /
-        (t->properties.T * ex->properties.P * ex->performance.Isp);
-
-      log_pc_pe = log_pc_pe +
-        (ex->properties.Isex*pow(flow_velocity, 2)/
-         (pow(flow_velocity, 2) - pow(sound_velocity,2))) *
-        (log(ae_at) - log(ex->performance.ae_at));
-
-      i++;
-      
-    } while ( (fabs((log_pc_pe - log(pc_pe))) > 0.00004) &&
-              (i < PC_PE_ITERATION_MAX) );
-
-    if (i == PC_PE_ITERATION_MAX)
+    else
     {
-      fprintf(errorfile,
-    "Exit pressure do not converge in %d iterations. Don't thrust results\n",
-              PC_PE_ITERATION_MAX);
+      /* out of range ( < 1.0 ), reported by the caller */
+      return ERR_AERA_RATIO;
     }
-    
-    //printf("%d iterations to evaluate exit pressure.\n", i);
-    
-    pc_pe            = exp(log_pc_pe);
-    exit_pressure    = e->properties.P/pc_pe;
-    
   }
-      
-  ex->properties.T = compute_temperature(e, exit_pressure,
-                                         chamber_entropy);
-  /* We must check if the exit temperature is more than 50 K lower
-     than any transition temperature of condensed species.
-     In this case the results are not good and must be reject. */
-
-  ex->properties.P    = exit_pressure;
-  ex->performance.Isp = sqrt(2000*(product_enthalpy(e)*R*e->properties.T -
-                                    product_enthalpy_exit(e, ex->properties.T)*
-                                    R*ex->properties.T));
+  else
+  {
+    return ERR_RATIO_TYPE;
+  }
+  return SUCCESS;
+}
 
+/* An equilibrium of the motor failed, a spent budget was already
+   reported by equilibrium() */
+static int equilibrium_failed(equilibrium_t *e, int err_code)
+{
+  if (err_code != ERR_BUDGET)
+    diag_raise(e, DIAG_NO_EQUILIBRIUM, err_code);
+  return err_code;
+}
 
-  /* units are (m/s/atm) */
-  ex->performance.a_dotm = 1000 * R * ex->properties.T * ex->itn.n /
-    (ex->properties.P * ex->performance.Isp);
+/* Find the equilibrium composition in the chamber if it have
+   not already been compute, or take it from the cache */
+static int chamber_equilibrium(equilibrium_t *e)
+{
+  int err_code;
 
-  compute_thermo_properties(ex);
-  
-  ex->properties.Vson = sqrt(1000 * e->itn.n * R * ex->properties.T *
-                             e->properties.Isex);
+  if (!(e->product.isequil))
+  {
+    if ((err_code = cached_equilibrium(e, HP)) < 0)
+      return equilibrium_failed(e, err_code);
+  }
+  return SUCCESS;
+}
 
-  
+/* Performance at the throat, once the throat state is known */
+static void throat_performance(equilibrium_t *e, equilibrium_t *t)
+{
   t->performance.a_dotm = 1000 * R * t->properties.T
     * t->itn.n / (t->properties.P * t->performance.Isp);
   t->performance.ae_at = 1.0;
@@ -298,7 +177,15 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
     (e->properties.P * t->performance.a_dotm);
   t->performance.Ivac  = t->performance.Isp + t->properties.P
     * t->performance.a_dotm;
+}
 
+/* Performance at an exit station, once the exit state is known */
+static void exit_performance(equilibrium_t *e, equilibrium_t *t,
+                             equilibrium_t *ex)
+{
+  ex->performance.a_dotm = 1000 * R * ex->properties.T * ex->itn.n /
+    (ex->properties.P * ex->performance.Isp);
+  
   ex->performance.ae_at =
     (ex->properties.T * t->properties.P * t->performance.Isp) /
     (t->properties.T * ex->properties.P * ex->performance.Isp);
@@ -307,234 +194,775 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
     (e->properties.P * t->performance.a_dotm);
   ex->performance.Ivac  = ex->performance.Isp + ex->properties.P
     * ex->performance.a_dotm;
-
-  return SUCCESS;
 }
 
-
-int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
-                         double value)
+/* State of the throat t at the pressure Pc/exp(x). Fill the squares
+   of the flow and sound velocities and the derivative of their
+   difference with x. stats sum the equilibria of a shifting throat. */
+static int throat_point(equilibrium_t *e, equilibrium_t *t, int frozen,
+                        double chamber_entropy, double x,
+                        solver_stats_t *stats,
+                        double *u2, double *a2, double *slope)
 {
   int err_code;
-  short i;
-  double sound_velocity = 0.0;
-  double flow_velocity;
-  double pc_pt;
-  double pc_pe;
-  double log_pc_pe;
-  double ae_at;
-  double chamber_entropy;
-  double exit_pressure = 0;
-  
-  equilibrium_t *t  = e + 1; /* throat equilibrium */
-  equilibrium_t *ex = e + 2; /* throat equilibrium */
-  
-  /* find the equilibrium composition in the chamber */
-  if (!(e->product.isequil))
-    /* if the equilibrium have not already been compute */
+
+  t->properties.P = e->properties.P/exp(x);
+
+  if (frozen)
   {
-    if ((err_code = equilibrium(e, HP)) < 0)
-    {
-      fprintf(outputfile, "No equilibrium, performance evaluation aborted.\n");
-      return err_code;
-    }
+    t->properties.T = compute_temperature(t, t, t->properties.P,
+                                          chamber_entropy, t->properties.T);
+    compute_thermo_properties(t);
+
+    *a2 = 1000 * e->itn.n * R * t->properties.T * t->properties.Isex;
+    *u2 = 2000*(product_enthalpy(e)*R*e->properties.T -
+                product_enthalpy_exit(e, t->properties.T)*R*t->properties.T);
+  }
+  else
+  {
+    /* derivative() give the sound velocity with the shifting
+       isentropic exponent */
+    err_code = equilibrium(t, SP);
+    solver_stats_add(stats, &(t->stats));
+    t->stats = *stats;
+    if (err_code < 0)
+      return equilibrium_failed(t, err_code);
+
+    *a2 = pow(t->properties.Vson, 2);
+    *u2 = 2000*(product_enthalpy(e)*R*e->properties.T -
+                product_enthalpy(t)*R*t->properties.T);
   }
 
-  /* Begin by first aproximate the new equilibrium to be
-     the same as the chamber equilibrium */
+  /* Along the isentrope d(u^2)/dx = 2 Pv and, as (dlnV/dlnP)s is
+     -1/Isex, d(a^2)/dx = -(1 - 1/Isex) a^2 with Pv = a^2/Isex */
+  *slope = 1000 * t->itn.n * R * t->properties.T * (t->properties.Isex + 1);
+  return SUCCESS;
+}
 
-  copy_equilibrium(t, e);
-  
-  chamber_entropy = product_entropy(e);
-  
-  /* Computing throat condition */
-  /* Approximation of the throat pressure */
-  pc_pt = pow(t->properties.Isex/2 + 0.5,
-              t->properties.Isex/(t->properties.Isex - 1) );
+/***************************************************************
+Solve the sonic condition u^2 = a^2 for x = ln(Pc/Pt), starting
+from the ideal gas ratio with the isentropic exponent of the
+chamber. The first step is a Newton step with the slope of
+throat_point, the following ones secant steps on the two last
+states, which also follow the change of the composition and of
+the exponent. The root stay bracketed between the chamber (x = 0,
+u = 0) and the last supersonic state, a step that leave the
+bracket is replaced by a bisection, and x is at most doubled
+while there is no supersonic state.
+
+The throat is the last state computed, its residual
+|u^2 - a^2|/u^2 is kept in the performance. A state that is not
+a number raise DIAG_THROAT and return ERR_EQUILIBRIUM.
+****************************************************************/
+static int throat_iteration(equilibrium_t *e, equilibrium_t *t, int frozen,
+                            double chamber_entropy, double *pc_pt)
+{
+  int    err_code;
+  short  i;
+  double gamma;
+  double x, x_prev = 0.0;
+  double f, f_prev = 0.0;
+  double lo = 0.0, hi = -1.0; /* bracket of x, no upper bound if hi < 0 */
+  double u2, a2, slope;
+  double residual;
 
+  solver_stats_t stats;  /* all the equilibrium() of the throat */
+
+  TIMELINE_VAR(iteration)
+
+  /* Begin from the chamber state */
+  copy_equilibrium(t, e);
+  memset(&(t->stats), 0, sizeof(solver_stats_t));
+  memset(&stats, 0, sizeof(solver_stats_t));
   t->entropy = chamber_entropy;
-    
-  i = 0;
-  do
-  { 
-    t->properties.P = e->properties.P/pc_pt;
 
-    /* We must compute the new equilibrium each time */
-    if ((err_code = equilibrium(t, SP)) < 0)
+  /* derivative() left the shifting exponent in the chamber, a
+     frozen throat start from the frozen one */
+  if (frozen)
+    compute_thermo_properties(t);
+
+  gamma = t->properties.Isex;
+  x     = log(pow(gamma/2 + 0.5, gamma/(gamma - 1)));
+
+  i = 0;
+  while (1)
+  {
+    if (budget_exhausted())
     {
-      fprintf(outputfile, "No equilibrium, performance evaluation aborted.\n");
+      diag_raise(t, DIAG_BUDGET, i);
+      return ERR_BUDGET;
+    }
+    TIMELINE_START(iteration);
+    if ((err_code = throat_point(e, t, frozen, chamber_entropy, x, &stats,
+                                 &u2, &a2, &slope)) < 0)
       return err_code;
+    i++;
+    TIMELINE_SPAN(iteration, "throat_iteration", i);
+
+    f        = u2 - a2;
+    residual = fabs(f/u2);
+
+    /* a state that is not a number is a failure, not a throat */
+    if (residual != residual)
+    {
+      diag_raise(t, DIAG_THROAT, i);
+      return ERR_EQUILIBRIUM;
     }
 
-    sound_velocity = sqrt (1000*t->itn.n*R*t->properties.T*
-                           t->properties.Isex);
-    
-    flow_velocity = sqrt (2000*(product_enthalpy(e)*R*e->properties.T -
-                                product_enthalpy(t)*R*t->properties.T));
+    if ((residual <= PC_PT_TOLERANCE) || (i == PC_PT_ITERATION_MAX))
+      break;
 
-    pc_pt = pc_pt / ( 1 + ((pow(flow_velocity, 2) - pow(sound_velocity, 2))
-                           /(1000*(t->properties.Isex + 1)*t->itn.n*R*
-                             t->properties.T)));
-    i++;
-  } while ((fabs((pow(flow_velocity, 2) - pow(sound_velocity, 2))
-                 /pow(flow_velocity, 2)) > 0.4e-4) &&
-           (i < PC_PT_ITERATION_MAX));
+    if (f < 0.0)
+      lo = x;
+    else
+      hi = x;
 
-  if (i == PC_PT_ITERATION_MAX)
+    /* secant slope when it is coherent with the sonic condition */
+    if ((i > 1) && (x != x_prev) && ((f - f_prev)/(x - x_prev) > 0.0))
+      slope = (f - f_prev)/(x - x_prev);
+
+    x_prev = x;
+    f_prev = f;
+    x     -= f/slope;
+
+    if ((x <= lo) || ((hi >= 0.0) ? (x >= hi) : (x > 2*x_prev)))
+      x = (hi >= 0.0) ? (lo + hi)/2 : 2*x_prev;
+  }
+
+  if (residual > PC_PT_TOLERANCE)
+    diag_raise(t, DIAG_THROAT, PC_PT_ITERATION_MAX);
+
+  *pc_pt = exp(x);
+
+  t->properties.P         = e->properties.P/(*pc_pt);
+  t->properties.Vson      = sqrt(a2);
+  t->performance.Isp      = t->properties.Vson;
+  t->performance.residual   = residual;
+  t->performance.iterations = i;
+
+  throat_performance(e, t);
+  return SUCCESS;
+}
+
+/* State of the exit station ex at the pressure Pc/exp(y). Fill the
+   squares of the flow and sound velocities. A frozen station start
+   its temperature iteration from its last temperature, stats sum the
+   equilibria of a shifting station. */
+static int exit_point(equilibrium_t *e, equilibrium_t *t, equilibrium_t *ex,
+                      int frozen, double chamber_entropy, double y,
+                      solver_stats_t *stats, double *u2, double *a2)
+{
+  int err_code;
+
+  ex->properties.P = e->properties.P/exp(y);
+
+  if (frozen)
+  {
+    ex->properties.T = compute_temperature(e, ex, ex->properties.P,
+                                           chamber_entropy, ex->properties.T);
+    compute_thermo_properties(ex);
+
+    *a2 = 1000 * ex->itn.n * R * ex->properties.T * ex->properties.Isex;
+    *u2 = 2000*(product_enthalpy(e)*R*e->properties.T -
+                product_enthalpy_exit(e, ex->properties.T)*R*ex->properties.T);
+  }
+  else
   {
-    fprintf(errorfile, "Throat pressure do not converge in %d iterations."
-            " Don't thrust results.\n", PC_PT_ITERATION_MAX);
+    ex->entropy = chamber_entropy;
+    err_code = equilibrium(ex, SP);
+    solver_stats_add(stats, &(ex->stats));
+    ex->stats = *stats;
+    if (err_code < 0)
+      return equilibrium_failed(ex, err_code);
+
+    *a2 = pow(ex->properties.Vson, 2);
+    *u2 = 2000*(product_enthalpy(e)*R*e->properties.T -
+                product_enthalpy(ex)*R*ex->properties.T);
   }
-  
-  //printf("%d iterations to evaluate throat pressure.\n", i);
 
-  t->properties.P    = e->properties.P/pc_pt;
-  t->properties.Vson = sound_velocity;
-  t->performance.Isp = sound_velocity;
+  ex->performance.Isp   = sqrt(*u2);
+  ex->performance.ae_at =
+    (ex->properties.T * t->properties.P * t->performance.Isp) /
+    (t->properties.T * ex->properties.P * ex->performance.Isp);
+  return SUCCESS;
+}
 
+/* Slope of ln(Ae/At) with ln(Pc/Pe) along the isentrope, positive
+   on the supersonic branch and negative on the subsonic one */
+#define AREA_SLOPE(u2, a2, isex) (((u2) - (a2))/((isex) * (u2)))
+
+/* First ln(Pc/Pe) of an area ratio exit. A Newton step from the
+   previous exit station guess if it is on the same branch of the
+   nozzle and its area ratio is within a factor WARM_START_RATIO,
+   else the empirical estimate. */
+static int exit_warm_start(equilibrium_t *e, equilibrium_t *guess,
+                           exit_condition_t exit_type, double ae_at,
+                           double pc_pt, double isex, double *y)
+{
+  int    err_code;
+  int    supersonic = (exit_type == SUPERSONIC_AREA_RATIO);
+  double y_guess, u2, a2;
 
-  t->performance.a_dotm = 1000 * R *
-    t->properties.T * t->itn.n /
-    (t->properties.P * t->performance.Isp);
-  
-  copy_equilibrium(ex, e);
+  /* also check the exit condition */
+  if ((err_code = exit_pressure_estimate(exit_type, ae_at, pc_pt, isex,
+                                         y)) < 0)
+    return err_code;
+
+  if ((guess == NULL) || (guess == e) || !(guess->performance.ae_at > 1.0))
+    return SUCCESS;
+
+  y_guess = log(e->properties.P/guess->properties.P);
+  u2      = pow(guess->performance.Isp, 2);
+  a2      = pow(guess->properties.Vson, 2);
+
+  if ((y_guess > 0.0) && (u2 != a2) &&
+      (fabs(log(ae_at/guess->performance.ae_at)) < log(WARM_START_RATIO)) &&
+      (supersonic ? (y_guess > log(pc_pt)) : (y_guess < log(pc_pt))))
+    *y = y_guess + (log(ae_at) - log(guess->performance.ae_at)) /
+      AREA_SLOPE(u2, a2, guess->properties.Isex);
+
+  return SUCCESS;
+}
+
+/***************************************************************
+Compute one exit station. For an area ratio, find y = ln(Pc/Pe)
+where h = ln(Ae/At) - ln(ae_at), with the sign that make h
+increase with y on the branch of the nozzle, is zero.
+
+The root is bracketed from the start: the supersonic branch is
+above the throat (where h = -ln(ae_at)) and the subsonic one
+between the chamber (where h tend to -infinity) and the throat.
+Each state give a Newton step with the slope AREA_SLOPE. A step
+that leave the bracket, or that follow a step which did not
+halve |h|, is replaced by an Illinois (modified regula falsi)
+step, by a bisection when the subsonic bracket still end at the
+chamber, or by doubling y when the supersonic one is still open.
+
+The station is the last state computed, there is no equilibrium
+after the iteration. Its residual is |ln(Ae/At) - ln(ae_at)|
+and its iterations the number of states computed. DIAG_EXIT is
+raised when PC_PE_ITERATION_MAX states did not converge. A state that is not a
+number raise DIAG_EXIT and return ERR_EQUILIBRIUM. guess is the
+previous station, its composition start a shifting equilibrium
+and its state the iteration; t0 is the starting temperature of a
+frozen station.
+****************************************************************/
+static int exit_iteration(equilibrium_t *e, equilibrium_t *t,
+                          equilibrium_t *ex, equilibrium_t *guess,
+                          int frozen, exit_condition_t exit_type,
+                          double value, double pc_pt, double chamber_entropy,
+                          double t0)
+{
+  int    err_code;
+  short  i = 0;
+  int    side = 0;        /* end of the bracket moved by the last step */
+  int    lo_known, hi_known;
+  int    converged = true;
+  double lo, hi;          /* bracket of y                             */
+  double h_lo, h_hi;      /* h at the ends, if known                  */
+  double sign = 1.0;
+  double y, y_new;
+  double h, h_prev = 0.0;
+  double slope;
+  double u2 = 0.0, a2 = 0.0;
+  double residual = 0.0;
+
+  solver_stats_t stats;  /* all the equilibrium() of the station */
+
+  TIMELINE_VAR(iteration)
 
   if (exit_type == PRESSURE)
   {
-    exit_pressure = value;
+    y = log(e->properties.P/value);
   }
   else
   {
-    ae_at = value;
+    /* from the previous station, before ex is overwritten */
+    if ((err_code = exit_warm_start(e, guess, exit_type, value, pc_pt,
+                                    t->properties.Isex, &y)) < 0)
+      return err_code;
+  }
+
+  if (frozen)
+    copy_equilibrium(ex, e);
+  else if (ex != guess)
+    copy_equilibrium(ex, guess);
+  memset(&(ex->stats), 0, sizeof(solver_stats_t));
+  memset(&stats, 0, sizeof(solver_stats_t));
+  ex->properties.T = frozen ? t0 : ex->properties.T;
 
-    /* Initial estimate of pressure ratio */
+  if (exit_type == PRESSURE)
+  {
+    if ((err_code = exit_point(e, t, ex, frozen, chamber_entropy, y,
+                               &stats, &u2, &a2)) < 0)
+      return err_code;
+    i = 1;
+  }
+  else
+  {
     if (exit_type == SUPERSONIC_AREA_RATIO)
     {
-      if ((ae_at > 1.0) && (ae_at < 2.0))
+      lo = log(pc_pt);  h_lo = -log(value); lo_known = true;
+      hi = 0.0;         h_hi = 0.0;         hi_known = false;
+    }
+    else
+    {
+      sign = -1.0;
+      lo = 0.0;         h_lo = 0.0;         lo_known = false;
+      hi = log(pc_pt);  h_hi = log(value);  hi_known = true;
+    }
+
+    if (!(y > lo) || (hi_known && !(y < hi)))
+      y = hi_known ? (lo + hi)/2 : 2*lo;
+
+    while (1)
+    {
+      if (budget_exhausted())
       {
-        log_pc_pe = log(pc_pt) + sqrt (3.294*pow(ae_at,2) + 1.535*log(ae_at));
+        diag_raise(ex, DIAG_BUDGET, i);
+        return ERR_BUDGET;
       }
-      else if (ae_at >= 2.0)
+      TIMELINE_START(iteration);
+      if ((err_code = exit_point(e, t, ex, frozen, chamber_entropy, y,
+                                 &stats, &u2, &a2)) < 0)
+        return err_code;
+      i++;
+      TIMELINE_SPAN(iteration, "exit_iteration", i);
+
+      h        = sign * (log(ex->performance.ae_at) - log(value));
+      slope    = sign * AREA_SLOPE(u2, a2, ex->properties.Isex);
+      residual = fabs(h);
+
+      /* a state that is not a number is a failure, not an exit */
+      if (residual != residual)
       {
-        log_pc_pe = t->properties.Isex + 1.4 * log(ae_at);
-      }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
+        diag_raise(ex, DIAG_EXIT, i);
+        return ERR_EQUILIBRIUM;
       }
-    }
-    else if (exit_type == SUBSONIC_AREA_RATIO)
-    {
-      if ((ae_at > 1.0) && (ae_at < 1.09))
+
+      /* the noise of the equilibrium hide small residuals in the
+         subsonic part, a small step is only trusted near the root:
+         the slope grow without bound toward the chamber */
+      converged = (residual <= PC_PE_TOLERANCE) ||
+        ((fabs(h/slope) <= PC_PE_TOLERANCE) &&
+         (residual <= PC_PE_STEP_RESIDUAL));
+      if (converged || (i == PC_PE_ITERATION_MAX))
+        break;
+
+      /* Illinois: the value kept at an end is halved when the other
+         end moved twice in a row */
+      if (h < 0.0)
       {
-        log_pc_pe = 0.9 * log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
+        lo = y;  h_lo = h;  lo_known = true;
+        if (side < 0)
+          h_hi /= 2;
+        side = -1;
       }
-      else if (ae_at >= 1.09)
+      else
       {
-        log_pc_pe = log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
+        hi = y;  h_hi = h;  hi_known = true;
+        if (side > 0)
+          h_lo /= 2;
+        side = 1;
       }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
+
+      y_new = y - h/slope;
+      if (!(slope > 0.0) || !(y_new > lo) || (hi_known && !(y_new < hi)) ||
+          ((i > 1) && (fabs(h) > fabs(h_prev)/2)))
+      {
+        if (lo_known && hi_known)
+          y_new = (lo*h_hi - hi*h_lo)/(h_hi - h_lo);
+        else if (hi_known)
+          y_new = (lo + hi)/2;
+        else
+          y_new = 2*lo;
       }
+      h_prev = h;
+      y      = y_new;
     }
-    else
-    {
-      return ERR_RATIO_TYPE;
-    }
 
+    if (!converged)
+      diag_raise(ex, DIAG_EXIT, i);
+  }
+
+  if (frozen)
+    ex->properties.Vson = sqrt(1000 * e->itn.n * R * ex->properties.T *
+                               e->properties.Isex);
+
+  exit_performance(e, t, ex);
+  ex->performance.residual   = residual;
+  ex->performance.iterations = i;
+  return SUCCESS;
+}
+
+static int throat_state(equilibrium_t *e, equilibrium_t *t, int frozen,
+                        double chamber_entropy, double *pc_pt);
+static int exit_state(equilibrium_t *e, equilibrium_t *t, equilibrium_t *ex,
+                      equilibrium_t *guess, int frozen,
+                      exit_condition_t exit_type, double value, double pc_pt,
+                      double chamber_entropy, double t0);
+
+static int frozen_multi(equilibrium_t *e, int n_exit,
+                        exit_condition_t *exit_type, double *value)
+{
+  int err_code;
+  int i;
+
+  double pc_pt;            /* Chamber pressure / Throat pressure */
+  double chamber_entropy;
+  double t0;
+  
+  equilibrium_t *t  = e + 1; /* throat equilibrium */
+  equilibrium_t *ex = e + 2; /* first exit equilibrium */
+  
+  if ((err_code = chamber_equilibrium(e)) < 0)
+    return err_code;
+
+  /* Simplification due to frozen equilibrium */
+  e->properties.dV_T =  1.0;
+  e->properties.dV_P = -1.0;
+  
+  chamber_entropy  = product_entropy(e);
+
+  if ((err_code = throat_state(e, t, true, chamber_entropy, &pc_pt)) < 0)
+    return err_code;
+
+  /* Now compute exit properties, each station start its pressure and
+     temperature iterations from the previous one */
+  t0 = e->properties.T;
+  for (i = 0; i < n_exit; i++)
+  {
+    if ((err_code = exit_state(e, t, ex + i, (i == 0) ? e : ex + i - 1,
+                               true, exit_type[i], value[i], pc_pt,
+                               chamber_entropy, t0)) < 0)
+      return err_code;
+
+    t0 = (ex + i)->properties.T;
+  }
+
+  return SUCCESS;
+}
+
+int frozen_performance_multi(equilibrium_t *e, int n_exit,
+                             exit_condition_t *exit_type, double *value)
+{
+  int err_code;
+  int traced;
+
+  traced   = trace_begin(TRACE_FROZEN, e, HP, n_exit, exit_type, value);
+  err_code = frozen_multi(e, n_exit, exit_type, value);
+  trace_end(traced);
+  return err_code;
+}
+
+int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
+                       double value)
+{
+  return frozen_performance_multi(e, 1, &exit_type, &value);
+}
+
+
+/* The throat and exit iterations, timed as their phase */
+static int throat_state(equilibrium_t *e, equilibrium_t *t, int frozen,
+                        double chamber_entropy, double *pc_pt)
+{
+  int err_code;
+
+  TIMER_VAR(timer)
+  TIMELINE_VAR(timeline)
+
+  TIMER_START(timer);
+  TIMELINE_START(timeline);
+  err_code = throat_iteration(e, t, frozen, chamber_entropy, pc_pt);
+  TIMELINE_SPAN(timeline, "throat", frozen);
+  TIMER_STOP(timer, TIMER_THROAT);
+  return err_code;
+}
+
+/* guess is the previous station, the start of the iteration and of
+   the composition of a shifting exit, t0 the starting temperature of
+   a frozen one */
+static int exit_state(equilibrium_t *e, equilibrium_t *t, equilibrium_t *ex,
+                      equilibrium_t *guess, int frozen,
+                      exit_condition_t exit_type, double value, double pc_pt,
+                      double chamber_entropy, double t0)
+{
+  int err_code;
+
+  TIMER_VAR(timer)
+  TIMELINE_VAR(timeline)
+
+  TIMER_START(timer);
+  TIMELINE_START(timeline);
+  err_code = exit_iteration(e, t, ex, guess, frozen, exit_type, value, pc_pt,
+                            chamber_entropy, t0);
+  TIMELINE_SPAN(timeline, "exit", frozen);
+  TIMER_STOP(timer, TIMER_EXIT);
+  return err_code;
+}
+
+static int shifting_multi(equilibrium_t *e, int n_exit,
+                          exit_condition_t *exit_type, double *value)
+{
+  int err_code;
+  int i;
+  double pc_pt;
+  double chamber_entropy;
+  
+  equilibrium_t *t  = e + 1; /* throat equilibrium */
+  equilibrium_t *ex = e + 2; /* first exit equilibrium */
+  
+  if ((err_code = chamber_equilibrium(e)) < 0)
+    return err_code;
+
+  chamber_entropy = product_entropy(e);
+
+  if ((err_code = throat_state(e, t, false, chamber_entropy, &pc_pt)) < 0)
+    return err_code;
+
+  /* The first exit start from the chamber composition, the following
+     ones from the neighbouring station */
+  for (i = 0; i < n_exit; i++)
+  {
+    if ((err_code = exit_state(e, t, ex + i, (i == 0) ? e : ex + i - 1,
+                               false, exit_type[i], value[i], pc_pt,
+                               chamber_entropy, 0.0)) < 0)
+      return err_code;
+  }
+  
+  return SUCCESS;
+}
+
+int shifting_performance_multi(equilibrium_t *e, int n_exit,
+                               exit_condition_t *exit_type, double *value)
+{
+  int err_code;
+  int traced;
+
+  traced   = trace_begin(TRACE_SHIFTING, e, HP, n_exit, exit_type, value);
+  err_code = shifting_multi(e, n_exit, exit_type, value);
+  trace_end(traced);
+  return err_code;
+}
+
+int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
+                         double value)
+{
+  return shifting_performance_multi(e, 1, &exit_type, &value);
+}
+
+
+/* Describe the flow at station st */
+static void fill_station(nozzle_station_t *s, equilibrium_t *st, int index,
+                         double ae_at, double u, double a)
+{
+  s->index = index;
+  s->ae_at = ae_at;
+  s->T     = st->properties.T;
+  s->P     = st->properties.P;
+  s->rho   = st->properties.P * ATM_TO_PA /
+    (1000 * st->itn.n * R * st->properties.T);
+  s->gamma = st->properties.Isex;
+  s->a     = a;
+  s->u     = u;
+  s->mach  = u / a;
+}
+
+static int nozzle_profile(equilibrium_t *e, int frozen, int n_station,
+                          exit_condition_t *exit_type, double *value,
+                          nozzle_sink_t sink, void *data)
+{
+  int    err_code;
+  int    i;
+  int    index = 0;
+  int    throat_done = false;
+  int    supersonic;
+  double pc_pt;
+  double chamber_entropy;
+  double t0;
+
+  nozzle_station_t s;
+
+  equilibrium_t *t  = e + 1; /* throat equilibrium */
+  equilibrium_t *ex = e + 2; /* working station */
+
+  if ((err_code = chamber_equilibrium(e)) < 0)
+    return err_code;
+
+  if (frozen)
+  {
+    /* Simplification due to frozen equilibrium */
+    e->properties.dV_T =  1.0;
+    e->properties.dV_P = -1.0;
+  }
+  
+  chamber_entropy = product_entropy(e);
+
+  if ((err_code = throat_state(e, t, frozen, chamber_entropy, &pc_pt)) < 0)
+    return err_code;
+
+  fill_station(&s, e, index++, 0.0, 0.0, e->properties.Vson);
+  if ((err_code = sink(e, &s, data)) < 0)
+    return err_code;
+  
+  /* The subsonic part start from the chamber */
+  copy_equilibrium(ex, e);
+  t0 = e->properties.T;
+  
+  for (i = 0; i < n_station; i++)
+  {
+    supersonic = (exit_type[i] == SUPERSONIC_AREA_RATIO) ||
+      ((exit_type[i] == PRESSURE) && (value[i] < t->properties.P));
     
-    /* Improved the estimate */
-    ex->entropy      = chamber_entropy;
-    i = 0;
-    do
+    if (supersonic && !throat_done)
     {
-      pc_pe            = exp(log_pc_pe);
-      ex->properties.P = exit_pressure    = e->properties.P/pc_pe;
-
-      
-      /* Find the exit equilibrium */
-      if ((err_code = equilibrium(ex, SP)) < 0)
-      {
-        fprintf(outputfile,
-                "No equilibrium, performance evaluation aborted.\n");
+      fill_station(&s, t, index++, 1.0, t->performance.Isp,
+                   t->properties.Vson);
+      if ((err_code = sink(t, &s, data)) < 0)
         return err_code;
-      }
-      
-      sound_velocity = ex->properties.Vson;
-     
-      ex->performance.Isp =
-        flow_velocity = sqrt(2000*(product_enthalpy(e)*R*e->properties.T -
-                                   product_enthalpy(ex)*R*ex->properties.T));
-      
-      ex->performance.ae_at =
-        (ex->properties.T * t->properties.P * t->performance.Isp) /
-        (t->properties.T * ex->properties.P * ex->performance.Isp);
-
-      log_pc_pe = log_pc_pe +
-        (ex->properties.Isex*pow(flow_velocity, 2)/
-         (pow(flow_velocity, 2) - pow(sound_velocity,2))) *
-        (log(ae_at) - log(ex->performance.ae_at));
-      i++;
-    } while ((fabs((log_pc_pe - log(pc_pe))) > 0.00004) &&
-             (i < PC_PE_ITERATION_MAX));
+      throat_done = true;
 
-    if (i == PC_PE_ITERATION_MAX)
-    {
-      fprintf(errorfile, "Exit pressure do not converge in %d iteration."
-              " Don't thrust results.\n", PC_PE_ITERATION_MAX);
+      /* and the supersonic part from the throat */
+      copy_equilibrium(ex, t);
+      t0 = t->properties.T;
     }
+
+    if ((err_code = exit_state(e, t, ex, ex, frozen, exit_type[i], value[i],
+                               pc_pt, chamber_entropy, t0)) < 0)
+      return err_code;
+
+    t0 = ex->properties.T;
     
-    //printf("%d iterations to evaluate exit pressure.\n", i);
-    
-    pc_pe            = exp(log_pc_pe);
-    exit_pressure    = e->properties.P/pc_pe;
+    fill_station(&s, ex, index++, ex->performance.ae_at, ex->performance.Isp,
+                 ex->properties.Vson);
+    if ((err_code = sink(ex, &s, data)) < 0)
+      return err_code;
   }
-  
-  ex->entropy      = chamber_entropy;
-  ex->properties.P = exit_pressure;
 
-  /* Find the exit equilibrium */
-  if ((err_code = equilibrium(ex, SP)) < 0)
+  if (!throat_done)
   {
-    fprintf(outputfile, "No equilibrium, performance evaluation aborted.\n");
-    return err_code;
+    fill_station(&s, t, index++, 1.0, t->performance.Isp, t->properties.Vson);
+    if ((err_code = sink(t, &s, data)) < 0)
+      return err_code;
   }
   
-  flow_velocity = sqrt(2000*(product_enthalpy(e)*R*e->properties.T -
-                             product_enthalpy(ex)*R*ex->properties.T));
+  return SUCCESS;
+}
 
-  
-  ex->performance.Isp = flow_velocity;
+int frozen_nozzle_profile(equilibrium_t *e, int n_station,
+                          exit_condition_t *exit_type, double *value,
+                          nozzle_sink_t sink, void *data)
+{
+  return nozzle_profile(e, true, n_station, exit_type, value, sink, data);
+}
 
-  ex->performance.a_dotm = 1000 * R *
-    ex->properties.T * ex->itn.n /
-    (ex->properties.P * ex->performance.Isp);
- 
-  t->performance.ae_at = 1.0;
-  t->performance.cstar = e->properties.P * t->performance.a_dotm;
-  t->performance.cf    = t->performance.Isp /
-    (e->properties.P * t->performance.a_dotm);
-  t->performance.Ivac  = t->performance.Isp + t->properties.P
-    * t->performance.a_dotm;
+int shifting_nozzle_profile(equilibrium_t *e, int n_station,
+                            exit_condition_t *exit_type, double *value,
+                            nozzle_sink_t sink, void *data)
+{
+  return nozzle_profile(e, false, n_station, exit_type, value, sink, data);
+}
+
+int nozzle_buffer_columns(equilibrium_t *e)
+{
+  return product_columns(e, 0, NULL);
+}
+
+int nozzle_buffer_sink(equilibrium_t *e, nozzle_station_t *s, void *data)
+{
+  double *row;
   
-  ex->performance.ae_at =
-    (ex->properties.T * t->properties.P * t->performance.Isp) /
-    (t->properties.T * ex->properties.P * ex->performance.Isp);
-  ex->performance.cstar = e->properties.P * t->performance.a_dotm;
-  ex->performance.cf    = ex->performance.Isp /
-    (e->properties.P * t->performance.a_dotm);
-  ex->performance.Ivac  = ex->performance.Isp + ex->properties.P
-    * ex->performance.a_dotm;
+  nozzle_buffer_t *b = (nozzle_buffer_t *) data;
+
+  if (b->n >= b->size)
+    return ERR_BUFFER_FULL;
+
+  /* the column list is taken from the first station */
+  if (b->n == 0)
+    product_columns(e, b->n_species, b->species);
+
+  row = b->data + b->n * (NOZZLE_NVAR + b->n_species);
+
+  row[0] = s->ae_at;
+  row[1] = s->T;
+  row[2] = s->P;
+  row[3] = s->rho;
+  row[4] = s->mach;
+  row[5] = s->gamma;
+  row[6] = s->a;
+  row[7] = s->u;
+
+  product_molar_fractions(e, b->n_species, b->species, row + NOZZLE_NVAR);
   
+  b->n++;
+  return SUCCESS;
+}
+
+
+int ambient_performance(equilibrium_t *ex, int n, double *pa,
+                        double *cf, double *isp, int *separated)
+{
+  int    i;
+  double Ivac   = ex->performance.Ivac;
+  double a_dotm = ex->performance.a_dotm;
+  double cstar  = ex->performance.cstar;
+  double pe     = ex->properties.P;
+
+  for (i = 0; i < n; i++)
+  {
+    isp[i]       = Ivac - pa[i] * a_dotm;
+    cf[i]        = isp[i] / cstar;
+    separated[i] = (pe < SEPARATION_PRESSURE_RATIO * pa[i]);
+  }
   return SUCCESS;
 }
 
+int altitude_performance(equilibrium_t *ex, int n, double *altitude,
+                         double *pa, double *cf, double *isp, int *separated)
+{
+  int i;
+
+  for (i = 0; i < n; i++)
+    pa[i] = standard_atmosphere_pressure(altitude[i]);
+
+  return ambient_performance(ex, n, pa, cf, isp, separated);
+}
+
+/* Layers of the U.S. Standard Atmosphere 1976 */
+#define ATMOSPHERE_LAYERS  7
+#define EARTH_RADIUS       6356766.0  /* m */
+#define ATMOSPHERE_TOP     84852.0    /* geopotential m */
+#define ATMOSPHERE_G0_M_R  0.034163195 /* g0 * M / R (K/m) */
+
+static const double layer_h[ATMOSPHERE_LAYERS] =    /* m     */
+{ 0.0, 11000.0, 20000.0, 32000.0, 47000.0, 51000.0, 71000.0 };
+static const double layer_lapse[ATMOSPHERE_LAYERS] = /* K/m  */
+{ -0.0065, 0.0, 0.001, 0.0028, 0.0, -0.0028, -0.002 };
+static const double layer_T[ATMOSPHERE_LAYERS] =     /* K    */
+{ 288.15, 216.65, 216.65, 228.65, 270.65, 270.65, 214.65 };
+static const double layer_P[ATMOSPHERE_LAYERS] =     /* Pa   */
+{ 101325.0, 22632.06, 5474.889, 868.0187, 110.9063, 66.93887, 3.956420 };
+
+double standard_atmosphere_pressure(double altitude)
+{
+  int    i;
+  double h;  /* geopotential altitude */
+  double dh;
+
+  h = EARTH_RADIUS * altitude / (EARTH_RADIUS + altitude);
 
+  if (h >= ATMOSPHERE_TOP)
+    return 0.0;
 
+  for (i = ATMOSPHERE_LAYERS - 1; i > 0; i--)
+    if (h >= layer_h[i])
+      break;
 
+  dh = h - layer_h[i];
 
+  if (layer_lapse[i] == 0.0)
+    return layer_P[i] * exp(-ATMOSPHERE_G0_M_R * dh / layer_T[i]) / ATM_TO_PA;
+  
+  return layer_P[i] * pow(layer_T[i] / (layer_T[i] + layer_lapse[i] * dh),
+                          ATMOSPHERE_G0_M_R / layer_lapse[i]) / ATM_TO_PA;
+}
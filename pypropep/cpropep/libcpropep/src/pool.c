@@ -0,0 +1,125 @@
+/* pool.c  -  Recycling of equilibrium_t blocks                       */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+
+#include "pool.h"
+#include "equilibrium.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+/* A free block, the structures are reused to link the list */
+typedef struct _pool_block
+{
+  struct _pool_block *next;
+} pool_block_t;
+
+static pool_block_t  *pool_free[POOL_MAX_BLOCK + 1];
+static int            pool_count[POOL_MAX_BLOCK + 1];
+
+static unsigned long  pool_allocated = 0;
+static unsigned long  pool_recycled  = 0;
+
+static mutex_t        pool_lock = MUTEX_INITIALIZER;
+
+
+equilibrium_t *equilibrium_pool_get(int n)
+{
+  int            i;
+  equilibrium_t *e = NULL;
+
+  if (n <= 0)
+    return NULL;
+
+  if (n <= POOL_MAX_BLOCK)
+  {
+    mutex_lock(&pool_lock);
+    if (pool_free[n] != NULL)
+    {
+      e            = (equilibrium_t *) pool_free[n];
+      pool_free[n] = pool_free[n]->next;
+      pool_count[n]--;
+      pool_recycled++;
+    }
+    mutex_unlock(&pool_lock);
+  }
+
+  if (e != NULL)
+  {
+    /* the link written over the status flags is cleared too */
+    for (i = 0; i < n; i++)
+      clear_equilibrium(e + i);
+    return e;
+  }
+
+  if ((e = (equilibrium_t *) calloc(n, sizeof(equilibrium_t))) == NULL)
+    return NULL;
+
+  for (i = 0; i < n; i++)
+    initialize_equilibrium(e + i);
+
+  mutex_lock(&pool_lock);
+  pool_allocated++;
+  mutex_unlock(&pool_lock);
+  return e;
+}
+
+void equilibrium_pool_release(equilibrium_t *e, int n)
+{
+  pool_block_t *b = (pool_block_t *) e;
+
+  if (e == NULL)
+    return;
+
+  if ((n > 0) && (n <= POOL_MAX_BLOCK))
+  {
+    mutex_lock(&pool_lock);
+    if (pool_count[n] < POOL_MAX_FREE)
+    {
+      b->next      = pool_free[n];
+      pool_free[n] = b;
+      pool_count[n]++;
+      b = NULL;
+    }
+    mutex_unlock(&pool_lock);
+  }
+
+  free(b);
+}
+
+void equilibrium_pool_trim(void)
+{
+  int           n;
+  pool_block_t *b;
+
+  mutex_lock(&pool_lock);
+  for (n = 0; n <= POOL_MAX_BLOCK; n++)
+  {
+    while (pool_free[n] != NULL)
+    {
+      b            = pool_free[n];
+      pool_free[n] = b->next;
+      free(b);
+    }
+    pool_count[n] = 0;
+  }
+  mutex_unlock(&pool_lock);
+}
+
+void equilibrium_pool_stats(unsigned long *allocated,
+                            unsigned long *recycled,
+                            unsigned long *free_blocks)
+{
+  int n;
+
+  mutex_lock(&pool_lock);
+  *allocated   = pool_allocated;
+  *recycled    = pool_recycled;
+  *free_blocks = 0;
+  for (n = 0; n <= POOL_MAX_BLOCK; n++)
+    *free_blocks += pool_count[n];
+  mutex_unlock(&pool_lock);
+}
@@ -28,7 +28,11 @@ char err_message[][64] = {
   "Error too much product",
   "Error in equilibrium",
   "Error bad aera ratio",
-  "Error bad aera ratio type"};
+  "Error bad aera ratio type",
+  "Error too many iterations",
+  "Error buffer full",
+  "Error bad snapshot",
+  "Error work budget exhausted"};
 
 FILE * errorfile;
 FILE * outputfile;
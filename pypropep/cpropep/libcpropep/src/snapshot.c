@@ -0,0 +1,152 @@
+/* snapshot.c  -  Compact binary snapshot of an equilibrium state      */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+#include "diskcache.h"
+#include "equilibrium.h"
+
+#include "compat.h"
+#include "return.h"
+
+#define SNAPSHOT_MAGIC   "CPSN"
+#define SNAPSHOT_VERSION 3
+
+/* Position in the snapshot, with buffer NULL the bytes are only
+   counted */
+typedef struct _cursor
+{
+  int   save;   /* true when writing the snapshot */
+  char *buffer;
+  int   size;
+  int   pos;
+} cursor_t;
+
+/* Copy size bytes between the field and the snapshot */
+static int transfer(cursor_t *c, void *field, int size)
+{
+  if (c->buffer != NULL)
+  {
+    if (c->pos + size > c->size)
+      return false;
+
+    if (c->save)
+      memcpy(c->buffer + c->pos, field, size);
+    else
+      memcpy(field, c->buffer + c->pos, size);
+  }
+  c->pos += size;
+  return true;
+}
+
+/* Both directions go through this list, so the save and the restore
+   always agree on the layout */
+static int transfer_equilibrium(cursor_t *c, equilibrium_t *e)
+{
+  char          magic[4];
+  int           version  = SNAPSHOT_VERSION;
+  unsigned long checksum = database_checksum();
+  unsigned long saved    = checksum;
+
+  product_t *p = &(e->product);
+
+  memcpy(magic, SNAPSHOT_MAGIC, 4);
+
+  if (!transfer(c, magic, 4) || memcmp(magic, SNAPSHOT_MAGIC, 4) ||
+      !transfer(c, &version, sizeof(int)) || (version != SNAPSHOT_VERSION) ||
+      !transfer(c, &saved, sizeof(unsigned long)) || (saved != checksum))
+    return ERR_BAD_SNAPSHOT;
+
+  if (!transfer(c, &(e->equilibrium_ok), sizeof(int)) ||
+      !transfer(c, &(e->properties_ok), sizeof(int)) ||
+      !transfer(c, &(e->performance_ok), sizeof(int)) ||
+      !transfer(c, &(e->entropy), sizeof(double)) ||
+      !transfer(c, &(e->itn.n), sizeof(double)) ||
+      !transfer(c, &(e->itn.ln_n), sizeof(double)) ||
+      !transfer(c, &(e->itn.sumn), sizeof(double)) ||
+      !transfer(c, &(e->properties), sizeof(equilib_prop_t)) ||
+      !transfer(c, &(e->performance), sizeof(performance_prop_t)))
+    return ERR_BAD_SNAPSHOT;
+
+  /* the counts come first so they can be checked before the arrays */
+  if (!transfer(c, &(e->propellant.ncomp), sizeof(short)) ||
+      !transfer(c, &(p->n_element), sizeof(short)) ||
+      !transfer(c, p->n, STATE_LAST * sizeof(short)) ||
+      !transfer(c, &(p->n_condensed), sizeof(short)) ||
+      !transfer(c, &(p->element_listed), sizeof(int)) ||
+      !transfer(c, &(p->product_listed), sizeof(int)) ||
+      !transfer(c, &(p->isequil), sizeof(int)))
+    return ERR_BAD_SNAPSHOT;
+
+  if ((e->propellant.ncomp < 0) || (e->propellant.ncomp > MAX_COMP) ||
+      (p->n_element < 0) || (p->n_element > MAX_ELEMENT) ||
+      (p->n[GAS] < 0) || (p->n[GAS] > MAX_PRODUCT) ||
+      (p->n_condensed < 0) || (p->n_condensed > MAX_PRODUCT) ||
+      (p->n[CONDENSED] < 0) || (p->n[CONDENSED] > p->n_condensed))
+    return ERR_BAD_SNAPSHOT;
+
+  if (!transfer(c, e->propellant.molecule,
+                e->propellant.ncomp * sizeof(short)) ||
+      !transfer(c, e->propellant.coef, e->propellant.ncomp * sizeof(double)) ||
+      !transfer(c, &(e->propellant.density), sizeof(double)) ||
+      !transfer(c, p->element, p->n_element * sizeof(short)) ||
+      !transfer(c, p->species[GAS], p->n[GAS] * sizeof(short)) ||
+      !transfer(c, p->coef[GAS], p->n[GAS] * sizeof(double)) ||
+      !transfer(c, e->itn.ln_nj, p->n[GAS] * sizeof(double)) ||
+      !transfer(c, p->species[CONDENSED], p->n_condensed * sizeof(short)) ||
+      !transfer(c, p->coef[CONDENSED], p->n_condensed * sizeof(double)))
+    return ERR_BAD_SNAPSHOT;
+
+  return SUCCESS;
+}
+
+int equilibrium_snapshot_size(equilibrium_t *e)
+{
+  cursor_t c;
+
+  c.save   = true;
+  c.buffer = NULL;
+  c.size   = 0;
+  c.pos    = 0;
+  transfer_equilibrium(&c, e);
+  return c.pos;
+}
+
+int save_equilibrium(equilibrium_t *e, char *buffer, int size)
+{
+  cursor_t c;
+
+  if (size < equilibrium_snapshot_size(e))
+    return ERR_BUFFER_FULL;
+
+  c.save   = true;
+  c.buffer = buffer;
+  c.size   = size;
+  c.pos    = 0;
+  transfer_equilibrium(&c, e);
+  return c.pos;
+}
+
+int restore_equilibrium(equilibrium_t *e, const char *buffer, int size)
+{
+  int      err_code;
+  cursor_t c;
+
+  initialize_equilibrium(e);
+  reset_element_list(e);
+
+  c.save   = false;
+  c.buffer = (char *) buffer;
+  c.size   = size;
+  c.pos    = 0;
+
+  if ((err_code = transfer_equilibrium(&c, e)) < 0)
+  {
+    initialize_equilibrium(e);
+    return err_code;
+  }
+  return SUCCESS;
+}
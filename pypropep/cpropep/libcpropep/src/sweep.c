@@ -0,0 +1,158 @@
+/* sweep.c  -  Performance of many mixture ratio, chamber pressure    */
+/*             and exit condition points in one call                  */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+
+#include "sweep.h"
+#include "diskcache.h"
+#include "equilibrium.h"
+#include "thermo.h"
+
+#include "compat.h"
+#include "return.h"
+
+/* Mass of a composition (g) */
+static double composition_mass(composition_t *c)
+{
+  int    i;
+  double mass = 0.0;
+
+  for (i = 0; i < c->ncomp; i++)
+    mass += c->coef[i] * propellant_molar_mass(c->molecule[i]);
+  return mass;
+}
+
+int sweep_columns(equilibrium_t *e, composition_t *fuel,
+                  composition_t *oxidizer)
+{
+  int i;
+  int err_code;
+
+  if (fuel->ncomp + oxidizer->ncomp > MAX_COMP)
+    return ERR_BUFFER_FULL;
+
+  initialize_equilibrium(e);
+  reset_equilibrium(e);
+
+  /* the amounts are set for each point */
+  for (i = 0; i < fuel->ncomp; i++)
+    add_in_propellant(e, fuel->molecule[i], fuel->coef[i]);
+  for (i = 0; i < oxidizer->ncomp; i++)
+    add_in_propellant(e, oxidizer->molecule[i], oxidizer->coef[i]);
+
+  list_element(e);
+  if ((err_code = list_product(e)) < 0)
+    return err_code;
+
+  return product_columns(e, 0, NULL);
+}
+
+/* Write the properties of one station */
+static double *station_row(equilibrium_t *e, double *row)
+{
+  row[0] = e->properties.P;
+  row[1] = e->properties.T;
+  row[2] = e->properties.H;
+  row[3] = e->properties.S;
+  row[4] = e->properties.M;
+  row[5] = e->properties.Cp;
+  row[6] = e->properties.Isex;
+  row[7] = e->properties.Vson;
+  return row + SWEEP_STATION_NVAR;
+}
+
+static int performance_sweep(equilibrium_t *e, int frozen,
+                             composition_t *fuel, composition_t *oxidizer,
+                             int n, double *of, double *pc,
+                             exit_condition_t exit_type, double *value,
+                             int n_species, short *species,
+                             double *data, int *status)
+{
+  int     i, j;
+  int     first = true;
+  double  fuel_mass;
+  double  oxidizer_mass;
+  double *row;
+
+  composition_t *c = &(e->propellant);
+
+  fuel_mass     = composition_mass(fuel);
+  oxidizer_mass = composition_mass(oxidizer);
+
+  for (i = 0; i < n; i++)
+  {
+    /* amounts for 1 g of fuel and of[i] g of oxidizer, the
+       ingredients are in the order given to sweep_columns */
+    for (j = 0; j < fuel->ncomp; j++)
+      c->coef[j] = fuel->coef[j] / fuel_mass;
+    for (j = 0; j < oxidizer->ncomp; j++)
+      c->coef[fuel->ncomp + j] = of[i] * oxidizer->coef[j] / oxidizer_mass;
+
+    e->properties.P             = pc[i];
+    e->product.isequil          = false;
+    e->product.n[CONDENSED]     = 0;
+
+    if (frozen)
+      status[i] = disk_cached_frozen_performance(e, 1, &exit_type, value + i);
+    else
+      status[i] = disk_cached_shifting_performance(e, 1, &exit_type,
+                                                   value + i);
+
+    row = data + i * (SWEEP_NVAR + n_species);
+
+    if (status[i] < 0)
+    {
+      for (j = 0; j < SWEEP_NVAR + n_species; j++)
+        row[j] = 0.0;
+      continue;
+    }
+
+    if (first)
+    {
+      product_columns(e + 2, n_species, species);
+      first = false;
+    }
+
+    *row++ = of[i];
+    row = station_row(e, row);
+    row = station_row(e + 1, row);
+    row = station_row(e + 2, row);
+
+    *row++ = e[2].performance.ae_at;
+    *row++ = e[2].performance.a_dotm;
+    *row++ = e[2].performance.cstar;
+    *row++ = e[2].performance.cf;
+    *row++ = e[2].performance.Ivac;
+    *row++ = e[2].performance.Isp;
+
+    product_molar_fractions(e + 2, n_species, species, row);
+  }
+
+  /* no point succeeded */
+  if (first)
+    product_columns(e, n_species, species);
+
+  return SUCCESS;
+}
+
+int frozen_performance_sweep(equilibrium_t *e, composition_t *fuel,
+                             composition_t *oxidizer, int n, double *of,
+                             double *pc, exit_condition_t exit_type,
+                             double *value, int n_species, short *species,
+                             double *data, int *status)
+{
+  return performance_sweep(e, true, fuel, oxidizer, n, of, pc, exit_type,
+                           value, n_species, species, data, status);
+}
+
+int shifting_performance_sweep(equilibrium_t *e, composition_t *fuel,
+                               composition_t *oxidizer, int n, double *of,
+                               double *pc, exit_condition_t exit_type,
+                               double *value, int n_species, short *species,
+                               double *data, int *status)
+{
+  return performance_sweep(e, false, fuel, oxidizer, n, of, pc, exit_type,
+                           value, n_species, species, data, status);
+}
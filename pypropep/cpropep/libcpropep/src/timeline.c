@@ -0,0 +1,233 @@
+/* timeline.c  -  Timeline of the solver internals in the Chrome       */
+/*                trace event format                                   */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "timeline.h"
+#include "timer.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+typedef struct _timeline_event
+{
+  const char *name;
+  double      start;    /* s                    */
+  double      length;   /* s, negative: instant */
+  int         arg;
+} timeline_event_t;
+
+/* The events of one thread, only this thread write in it. A ring
+   is kept with its events when its thread exit, and taken by the
+   next new thread that continue its lane. */
+typedef struct _timeline_ring
+{
+  struct _timeline_ring *next;
+  int                    thread;     /* lane in the trace */
+  int                    in_use;     /* a running thread own it */
+  volatile unsigned long head;       /* events recorded   */
+  timeline_event_t       event[TIMELINE_RING_SIZE];
+} timeline_ring_t;
+
+/* head is published after the event is written */
+#ifdef __GNUC__
+#define PUBLISH(r, h) __atomic_store_n(&((r)->head), (h), __ATOMIC_RELEASE)
+#else
+#define PUBLISH(r, h) ((r)->head = (h))
+#endif
+
+static timeline_ring_t *timeline_rings = NULL;
+static int              timeline_threads = 0;
+static mutex_t          timeline_lock = MUTEX_INITIALIZER;
+static thread_key_t     timeline_key;  /* release the ring at exit */
+static int              timeline_key_created = false;
+
+static THREAD_LOCAL timeline_ring_t *ring = NULL;
+
+int timeline_enabled(void)
+{
+#ifdef TIMELINE
+  return true;
+#else
+  return false;
+#endif
+}
+
+/* Called at the exit of a thread */
+static void release_ring(void *r)
+{
+  mutex_lock(&timeline_lock);
+  ((timeline_ring_t *) r)->in_use = false;
+  mutex_unlock(&timeline_lock);
+  ring = NULL;
+}
+
+/* Ring of the calling thread, taken at its first event */
+static timeline_ring_t *thread_ring(void)
+{
+  timeline_ring_t *r;
+
+  if (ring != NULL)
+    return ring;
+
+  mutex_lock(&timeline_lock);
+
+  if (!timeline_key_created)
+  {
+    thread_key_create(&timeline_key, release_ring);
+    timeline_key_created = true;
+  }
+
+  for (r = timeline_rings; r != NULL; r = r->next)
+    if (!r->in_use)
+      break;
+
+  if (r == NULL)
+  {
+    if ((r = (timeline_ring_t *) malloc(sizeof(timeline_ring_t))) == NULL)
+    {
+      mutex_unlock(&timeline_lock);
+      return NULL;
+    }
+    r->head        = 0;
+    r->thread      = ++timeline_threads;
+    r->next        = timeline_rings;
+    timeline_rings = r;
+  }
+  r->in_use = true;
+
+  mutex_unlock(&timeline_lock);
+
+  thread_key_set(timeline_key, r);
+  ring = r;
+  return r;
+}
+
+static void add_event(const char *name, double start, double length, int arg)
+{
+  unsigned long     h;
+  timeline_event_t *ev;
+  timeline_ring_t  *r = thread_ring();
+
+  if (r == NULL)
+    return;
+
+  h  = r->head;
+  ev = r->event + (h % TIMELINE_RING_SIZE);
+  ev->name   = name;
+  ev->start  = start;
+  ev->length = length;
+  ev->arg    = arg;
+  PUBLISH(r, h + 1);
+}
+
+void timeline_span(const char *name, double start, int arg)
+{
+  add_event(name, start, timer_now() - start, arg);
+}
+
+void timeline_mark(const char *name, int arg)
+{
+  add_event(name, timer_now(), -1.0, arg);
+}
+
+/* First event kept in r and the number of events after it */
+static unsigned long ring_events(timeline_ring_t *r, unsigned long *first)
+{
+  unsigned long h = r->head;
+
+  *first = (h > TIMELINE_RING_SIZE) ? h - TIMELINE_RING_SIZE : 0;
+  return h - *first;
+}
+
+int timeline_write(const char *filename)
+{
+  unsigned long     i, n, first;
+  unsigned long     recorded, dropped;
+  double            origin = -1.0;
+  int               sep = 0;
+  FILE             *fd;
+  timeline_ring_t  *r;
+  timeline_event_t *ev;
+
+  if ((fd = fopen(filename, "w")) == NULL)
+    return ERR_FOPEN;
+
+  timeline_stats(&recorded, &dropped);
+
+  mutex_lock(&timeline_lock);
+
+  for (r = timeline_rings; r != NULL; r = r->next)
+  {
+    n = ring_events(r, &first);
+    for (i = first; i < first + n; i++)
+    {
+      ev = r->event + (i % TIMELINE_RING_SIZE);
+      if ((origin < 0.0) || (ev->start < origin))
+        origin = ev->start;
+    }
+  }
+
+  fprintf(fd, "{\"traceEvents\":[");
+  for (r = timeline_rings; r != NULL; r = r->next)
+  {
+    fprintf(fd, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+            "\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+            sep++ ? "," : "", r->thread, r->thread);
+
+    n = ring_events(r, &first);
+    for (i = first; i < first + n; i++)
+    {
+      ev = r->event + (i % TIMELINE_RING_SIZE);
+      fprintf(fd, ",\n{\"name\":\"%s\",\"cat\":\"cpropep\",\"pid\":1,"
+              "\"tid\":%d,\"ts\":%.3f,", ev->name, r->thread,
+              1e6 * (ev->start - origin));
+      if (ev->length < 0.0)
+        fprintf(fd, "\"ph\":\"i\",\"s\":\"t\",");
+      else
+        fprintf(fd, "\"ph\":\"X\",\"dur\":%.3f,", 1e6 * ev->length);
+      fprintf(fd, "\"args\":{\"arg\":%d}}", ev->arg);
+    }
+  }
+  mutex_unlock(&timeline_lock);
+
+  fprintf(fd, "\n],\n\"displayTimeUnit\":\"ns\",\n"
+          "\"otherData\":{\"recorded\":%lu,\"dropped\":%lu}}\n",
+          recorded, dropped);
+
+  if (fclose(fd) != 0)
+    return ERROR;
+  return SUCCESS;
+}
+
+void timeline_reset(void)
+{
+  timeline_ring_t *r;
+
+  mutex_lock(&timeline_lock);
+  for (r = timeline_rings; r != NULL; r = r->next)
+    r->head = 0;
+  mutex_unlock(&timeline_lock);
+}
+
+void timeline_stats(unsigned long *recorded, unsigned long *dropped)
+{
+  unsigned long    first;
+  timeline_ring_t *r;
+
+  *recorded = 0;
+  *dropped  = 0;
+
+  mutex_lock(&timeline_lock);
+  for (r = timeline_rings; r != NULL; r = r->next)
+  {
+    *recorded += r->head;
+    ring_events(r, &first);
+    *dropped  += first;
+  }
+  mutex_unlock(&timeline_lock);
+}
@@ -0,0 +1,194 @@
+/* timer.c  -  Time spent in each phase of the computation            */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_MSC_VER) || defined(BORLAND)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "timer.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+static const char *phase_name[TIMER_LAST] = {
+  "load", "list", "chamber", "throat", "exit", "derivative"
+};
+
+/* The statistics of one thread, only this thread write in them.
+   A block is kept with its statistics when its thread exit, and
+   taken by the next new thread: the list grow with the number of
+   threads running at the same time. */
+typedef struct _timer_block
+{
+  struct _timer_block *next;
+  int                  in_use;    /* a running thread own it */
+  timer_stat_t         stat[TIMER_LAST];
+} timer_block_t;
+
+static timer_block_t *timer_blocks = NULL;
+static mutex_t        timer_lock = MUTEX_INITIALIZER;
+static thread_key_t   timer_key;  /* release the block at exit */
+static int            timer_key_created = false;
+
+static THREAD_LOCAL timer_block_t *block = NULL;
+
+int timer_enabled(void)
+{
+#ifdef TIMING
+  return true;
+#else
+  return false;
+#endif
+}
+
+double timer_now(void)
+{
+#if defined(_MSC_VER) || defined(BORLAND)
+  LARGE_INTEGER count, frequency;
+
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&frequency);
+  return (double) count.QuadPart / (double) frequency.QuadPart;
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+/* Called at the exit of a thread */
+static void release_block(void *b)
+{
+  mutex_lock(&timer_lock);
+  ((timer_block_t *) b)->in_use = false;
+  mutex_unlock(&timer_lock);
+  block = NULL;
+}
+
+/* Statistics of the calling thread, taken at its first run */
+static timer_block_t *thread_block(void)
+{
+  timer_block_t *b;
+
+  if (block != NULL)
+    return block;
+
+  mutex_lock(&timer_lock);
+
+  if (!timer_key_created)
+  {
+    thread_key_create(&timer_key, release_block);
+    timer_key_created = true;
+  }
+
+  for (b = timer_blocks; b != NULL; b = b->next)
+    if (!b->in_use)
+      break;
+
+  if (b == NULL)
+  {
+    if ((b = (timer_block_t *) calloc(1, sizeof(timer_block_t))) == NULL)
+    {
+      mutex_unlock(&timer_lock);
+      return NULL;
+    }
+    b->next      = timer_blocks;
+    timer_blocks = b;
+  }
+  b->in_use = true;
+
+  mutex_unlock(&timer_lock);
+
+  thread_key_set(timer_key, b);
+  block = b;
+  return b;
+}
+
+void timer_add(timer_phase_t phase, double seconds)
+{
+  timer_stat_t  *s;
+  timer_block_t *b;
+
+  if ((phase < 0) || (phase >= TIMER_LAST))
+    return;
+
+  if ((b = thread_block()) == NULL)
+    return;
+
+  s = b->stat + phase;
+  s->count++;
+  s->total += seconds;
+  if (seconds > s->max)
+    s->max = seconds;
+}
+
+void timer_stats(timer_stat_t *stats)
+{
+  int            i;
+  timer_block_t *b;
+
+  memset(stats, 0, TIMER_LAST * sizeof(timer_stat_t));
+
+  mutex_lock(&timer_lock);
+  for (b = timer_blocks; b != NULL; b = b->next)
+  {
+    for (i = 0; i < TIMER_LAST; i++)
+    {
+      stats[i].count += b->stat[i].count;
+      stats[i].total += b->stat[i].total;
+      if (b->stat[i].max > stats[i].max)
+        stats[i].max = b->stat[i].max;
+    }
+  }
+  mutex_unlock(&timer_lock);
+}
+
+void timer_reset(void)
+{
+  timer_block_t *b;
+
+  mutex_lock(&timer_lock);
+  for (b = timer_blocks; b != NULL; b = b->next)
+    memset(b->stat, 0, TIMER_LAST * sizeof(timer_stat_t));
+  mutex_unlock(&timer_lock);
+}
+
+const char *timer_name(timer_phase_t phase)
+{
+  if ((phase < 0) || (phase >= TIMER_LAST))
+    return "";
+  return phase_name[phase];
+}
+
+int timer_report(FILE *fd)
+{
+  int          i;
+  timer_stat_t stats[TIMER_LAST];
+
+  if (!timer_enabled())
+  {
+    fprintf(fd, "Timers not compiled, define TIMING.\n");
+    return ERROR;
+  }
+
+  timer_stats(stats);
+
+  fprintf(fd, "Phase          Count   Total (ms)    Mean (us)     Max (us)\n");
+  for (i = 0; i < TIMER_LAST; i++)
+  {
+    fprintf(fd, "%-10s %9lu %12.3f %12.3f %12.3f\n", phase_name[i],
+            stats[i].count, 1e3 * stats[i].total,
+            (stats[i].count > 0) ? 1e6 * stats[i].total / stats[i].count : 0.0,
+            1e6 * stats[i].max);
+  }
+  return SUCCESS;
+}
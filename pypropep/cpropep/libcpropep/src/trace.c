@@ -0,0 +1,231 @@
+/* trace.c  -  Recording of the requests to the solvers               */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "trace.h"
+#include "diskcache.h"
+#include "equilibrium.h"
+
+#include "compat.h"
+#include "mutex.h"
+#include "return.h"
+
+#define TRACE_MAGIC "CPTRACE1"
+
+/* Longest record */
+#define TRACE_RECORD (4 + MAX_COMP * (sizeof(short) + sizeof(double)) + \
+                      3 * sizeof(double) + sizeof(short) +               \
+                      TRACE_MAX_EXIT * (1 + sizeof(double)))
+
+static FILE *trace_file = NULL;
+
+/* read without the lock by trace_begin, a request begun while the
+   trace is opened may be missed */
+static volatile int trace_on = false;
+
+static unsigned long trace_recorded = 0;
+static unsigned long trace_dropped  = 0;
+
+static mutex_t trace_lock = MUTEX_INITIALIZER;
+
+/* requests of the thread being solved, the inner ones are not
+   recorded */
+static THREAD_LOCAL int trace_depth = 0;
+
+static const char *kind_name[TRACE_LAST] = {
+  "equilibrium", "frozen", "shifting"
+};
+
+const char *trace_kind_name(trace_kind_t kind)
+{
+  if ((kind < 0) || (kind >= TRACE_LAST))
+    return "unknown";
+  return kind_name[kind];
+}
+
+int trace_open(const char *filename)
+{
+  FILE          *fd;
+  unsigned long  checksum = database_checksum();
+
+  if ((fd = fopen(filename, "wb")) == NULL)
+    return ERR_FOPEN;
+
+  if ((fwrite(TRACE_MAGIC, 1, 8, fd) != 8) ||
+      (fwrite(&checksum, sizeof(unsigned long), 1, fd) != 1))
+  {
+    fclose(fd);
+    return ERR_FOPEN;
+  }
+
+  trace_close();
+
+  mutex_lock(&trace_lock);
+  trace_file     = fd;
+  trace_recorded = 0;
+  trace_dropped  = 0;
+  trace_on       = true;
+  mutex_unlock(&trace_lock);
+  return SUCCESS;
+}
+
+int trace_close(void)
+{
+  int err_code = SUCCESS;
+
+  mutex_lock(&trace_lock);
+  trace_on = false;
+  if (trace_file != NULL)
+  {
+    if (fclose(trace_file) != 0)
+      err_code = ERROR;
+    trace_file = NULL;
+  }
+  mutex_unlock(&trace_lock);
+  return err_code;
+}
+
+void trace_stats(unsigned long *recorded, unsigned long *dropped)
+{
+  mutex_lock(&trace_lock);
+  *recorded = trace_recorded;
+  *dropped  = trace_dropped;
+  mutex_unlock(&trace_lock);
+}
+
+static char *put(char *p, const void *x, size_t size)
+{
+  memcpy(p, x, size);
+  return p + size;
+}
+
+static void record(trace_kind_t kind, equilibrium_t *e, problem_t P,
+                   int n_exit, exit_condition_t *exit_type, double *value)
+{
+  int   i;
+  short n;
+  char  c;
+  char  buffer[TRACE_RECORD];
+  char *p = buffer;
+
+  composition_t *comp = &(e->propellant);
+
+  if ((n_exit > TRACE_MAX_EXIT) || (comp->ncomp > MAX_COMP))
+  {
+    mutex_lock(&trace_lock);
+    trace_dropped++;
+    mutex_unlock(&trace_lock);
+    return;
+  }
+
+  c = kind;
+  p = put(p, &c, 1);
+  c = P;
+  p = put(p, &c, 1);
+  p = put(p, &(comp->ncomp), sizeof(short));
+  for (i = 0; i < comp->ncomp; i++)
+  {
+    p = put(p, comp->molecule + i, sizeof(short));
+    p = put(p, comp->coef + i, sizeof(double));
+  }
+  p = put(p, &(e->properties.P), sizeof(double));
+  p = put(p, &(e->properties.T), sizeof(double));
+  p = put(p, &(e->entropy), sizeof(double));
+  n = n_exit;
+  p = put(p, &n, sizeof(short));
+  for (i = 0; i < n_exit; i++)
+  {
+    c = exit_type[i];
+    p = put(p, &c, 1);
+    p = put(p, value + i, sizeof(double));
+  }
+
+  mutex_lock(&trace_lock);
+  if (trace_file != NULL)
+  {
+    if (fwrite(buffer, 1, p - buffer, trace_file) == (size_t) (p - buffer))
+      trace_recorded++;
+    else
+      trace_dropped++;
+  }
+  mutex_unlock(&trace_lock);
+}
+
+int trace_begin(trace_kind_t kind, equilibrium_t *e, problem_t P,
+                int n_exit, exit_condition_t *exit_type, double *value)
+{
+  if (!trace_on)
+    return false;
+
+  if (trace_depth == 0)
+    record(kind, e, P, n_exit, exit_type, value);
+  trace_depth++;
+  return true;
+}
+
+void trace_end(int traced)
+{
+  if (traced)
+    trace_depth--;
+}
+
+int trace_read_header(FILE *fd, unsigned long *checksum)
+{
+  char magic[8];
+
+  if ((fread(magic, 1, 8, fd) != 8) ||
+      (memcmp(magic, TRACE_MAGIC, 8) != 0) ||
+      (fread(checksum, sizeof(unsigned long), 1, fd) != 1))
+    return ERROR;
+  return SUCCESS;
+}
+
+static int get(FILE *fd, void *x, size_t size)
+{
+  return (fread(x, 1, size, fd) == size) ? SUCCESS : ERROR;
+}
+
+int trace_read(FILE *fd, trace_request_t *r)
+{
+  int   i;
+  short n;
+  char  c[2];
+
+  if (fread(c, 1, 2, fd) != 2)
+    return ERR_EOF;
+
+  r->kind    = c[0];
+  r->problem = c[1];
+  if ((r->kind < 0) || (r->kind >= TRACE_LAST))
+    return ERROR;
+
+  if ((get(fd, &n, sizeof(short)) < 0) || (n < 0) || (n > MAX_COMP))
+    return ERROR;
+  r->propellant.ncomp = n;
+  for (i = 0; i < n; i++)
+  {
+    if ((get(fd, r->propellant.molecule + i, sizeof(short)) < 0) ||
+        (get(fd, r->propellant.coef + i, sizeof(double)) < 0))
+      return ERROR;
+  }
+
+  if ((get(fd, &(r->P), sizeof(double)) < 0) ||
+      (get(fd, &(r->T), sizeof(double)) < 0) ||
+      (get(fd, &(r->entropy), sizeof(double)) < 0))
+    return ERROR;
+
+  if ((get(fd, &n, sizeof(short)) < 0) || (n < 0) || (n > TRACE_MAX_EXIT))
+    return ERROR;
+  r->n_exit = n;
+  for (i = 0; i < n; i++)
+  {
+    if ((get(fd, c, 1) < 0) ||
+        (get(fd, r->value + i, sizeof(double)) < 0))
+      return ERROR;
+    r->exit_type[i] = c[0];
+  }
+  return SUCCESS;
+}
@@ -53,6 +53,9 @@ typedef struct status
  *
  * neq: number of equation in the system
  *
+ * Return 0, or NO_SOLUTION without printing anything if the
+ * matrix is singular
+ *
  * Antoine Lefebvre
  *    february 6, 2000 Initial version
  *    october 20, 2000 revision of the permutation method
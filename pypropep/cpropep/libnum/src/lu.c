@@ -78,9 +78,11 @@ int NUM_lu(double *matrix, double *solution, int neq)
       P[idx] = tmp;
     }
 
+    /* singular, no unique solution. Reported by the caller */
     if (matrix[i + neq*P[i]] == 0.0)
     {
-      printf("LU: matrix is singular, no unique solution.\n");
+      free (P);
+      free (y);
       return NO_SOLUTION;
     }
     
@@ -119,7 +121,8 @@ int NUM_lu(double *matrix, double *solution, int neq)
   {
     if (matrix[i + neq*P[i]] == 0.0)
     {
-      printf("LU: No unique solution exist.\n");
+      free (P);
+      free (y);
       return NO_SOLUTION;
     }
     
@@ -130,6 +133,7 @@ int NUM_lu(double *matrix, double *solution, int neq)
     solution[P[i]] = (y[i] - tmp)/matrix[i + neq*P[i]];    
   }
      
+  free (P);
   free (y);
   return 0;      
 }
@@ -61,6 +61,10 @@ extern const char symb[][3];
 extern unsigned long num_thermo;
 extern unsigned long num_propellant;
 
+/* Change each time the data are reloaded, anything computed
+   from the previous data should be discarded */
+extern unsigned long database_version;
+
 /*************************************************************
 FUNCTION: Search in the field name of thermo_list and return
           the value of the found item.
@@ -77,6 +81,19 @@ int thermo_search(char *str);
 
 int propellant_search(char *str);
 
+/*************************************************************
+FUNCTION: Return the position in thermo_list (propellant_list)
+          of the species with exactly this name. When several
+          species have the same name, occurrence select which one
+          in the order of the list, 0 is the first.
+
+COMMENTS: If nothing is found, it return -1. The names are
+          sorted the first time a search is done after the data
+          are loaded, a search is then a binary search.
+**************************************************************/
+int thermo_name_lookup(char *name, int occurrence);
+int propellant_name_lookup(char *name, int occurrence);
+
 int atomic_number(char *symbole);
 
 int propellant_search_by_formula(char *str);
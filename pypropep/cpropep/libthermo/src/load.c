@@ -44,6 +44,8 @@ int load_thermo(char *filename)
   if ((fd = fopen(filename, "r")) == NULL )
     return ERR_FOPEN;
 
+  database_version++;
+
   if (global_verbose)
   {
     printf("Scanning thermo data file...");
@@ -334,6 +336,8 @@ int load_propellant(char *filename)
   if ((fd = fopen(filename, "r")) == NULL )
 		return ERR_FOPEN;
 
+  database_version++;
+
   if (global_verbose)
   {
     printf("Scanning propellant data file...");
@@ -16,13 +16,18 @@
 
 #include "thermo.h"
 #include "compat.h"
+#include "mutex.h"
 #include "conversion.h"
+#include "return.h"
 
 /**************************************************************
 These variables hold the number of records for propellant and thermo data
 ***************************************************************/
 unsigned long num_propellant, num_thermo;
 
+/* incremented each time thermo_list or propellant_list is reloaded */
+unsigned long database_version = 0;
+
 /* global variable containing the information about chemical species */
 propellant_t	*propellant_list;
 thermo_t	    *thermo_list;
@@ -375,6 +380,131 @@ int propellant_search(char *str)
 }
 
 
+/* Index of thermo_list and propellant_list sorted by name, built
+   the first time a name is looked up after the data are loaded */
+static int           *thermo_index             = NULL;
+static unsigned long  thermo_index_version     = 0;
+static int           *propellant_index         = NULL;
+static unsigned long  propellant_index_version = 0;
+static mutex_t        name_index_lock          = MUTEX_INITIALIZER;
+
+/* Order by name then by position in the list */
+static int thermo_name_compare(const void *a, const void *b)
+{
+  int i = *((const int *) a);
+  int j = *((const int *) b);
+  int r = strcmp((thermo_list + i)->name, (thermo_list + j)->name);
+  return r ? r : i - j;
+}
+
+static int propellant_name_compare(const void *a, const void *b)
+{
+  int i = *((const int *) a);
+  int j = *((const int *) b);
+  int r = strcmp((propellant_list + i)->name, (propellant_list + j)->name);
+  return r ? r : i - j;
+}
+
+static char *thermo_name(int i)
+{
+  return (thermo_list + i)->name;
+}
+
+static char *propellant_name(int i)
+{
+  return (propellant_list + i)->name;
+}
+
+static int *build_name_index(unsigned long n,
+                             int (*compare)(const void *, const void *))
+{
+  unsigned long i;
+  int *index;
+
+  if ((index = (int *) malloc((n + 1) * sizeof(int))) == NULL)
+    return NULL;
+
+  for (i = 0; i < n; i++)
+    index[i] = i;
+  qsort(index, n, sizeof(int), compare);
+  return index;
+}
+
+/* Binary search of the first entry of the name then step to the
+   occurrence asked */
+static int search_name_index(int *index, unsigned long n,
+                             char *(*name_of)(int), char *name,
+                             int occurrence)
+{
+  unsigned long low  = 0;
+  unsigned long high = n;
+  unsigned long mid;
+
+  while (low < high)
+  {
+    mid = (low + high) / 2;
+    if (strcmp(name_of(index[mid]), name) < 0)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  if (occurrence < 0)
+    return -1;
+
+  low += occurrence;
+  if ((low >= n) || strcmp(name_of(index[low]), name))
+    return -1;
+  return index[low];
+}
+
+int thermo_name_lookup(char *name, int occurrence)
+{
+  int i;
+
+  mutex_lock(&name_index_lock);
+  if ((thermo_index == NULL) || (thermo_index_version != database_version))
+  {
+    free(thermo_index);
+    if ((thermo_index = build_name_index(num_thermo, thermo_name_compare))
+        == NULL)
+    {
+      mutex_unlock(&name_index_lock);
+      return ERR_MALLOC;
+    }
+    thermo_index_version = database_version;
+  }
+  i = search_name_index(thermo_index, num_thermo, thermo_name, name,
+                        occurrence);
+  mutex_unlock(&name_index_lock);
+  return i;
+}
+
+int propellant_name_lookup(char *name, int occurrence)
+{
+  int i;
+
+  mutex_lock(&name_index_lock);
+  if ((propellant_index == NULL) ||
+      (propellant_index_version != database_version))
+  {
+    free(propellant_index);
+    if ((propellant_index = build_name_index(num_propellant,
+                                             propellant_name_compare))
+        == NULL)
+    {
+      mutex_unlock(&name_index_lock);
+      return ERR_MALLOC;
+    }
+    propellant_index_version = database_version;
+  }
+  i = search_name_index(propellant_index, num_propellant,
+                        propellant_name, name, occurrence);
+  mutex_unlock(&name_index_lock);
+  return i;
+}
+
+
 int atomic_number(char *symbole)
 {
   int i;
@@ -0,0 +1,84 @@
+from .cpropep._cpropep import ffi, lib
+
+__all__ = ['Diagnostics', 'warning_names']
+
+
+def warning_names(warnings):
+    '''
+    Names of the diagnostics ('singular', 'throat', ...) set in the
+    warnings mask of the solver statistics.
+    '''
+    return [ffi.string(lib.diag_name(i)).decode('utf-8')
+            for i in range(lib.DIAG_LAST) if warnings & (1 << i)]
+
+
+class Diagnostics(object):
+    '''
+    Collects the diagnostics raised by the solvers in the calling
+    thread instead of printing them:
+
+        with pypropep.Diagnostics(limit=5) as d:
+            p.set_state(P=50., Ae_At=40.)
+        d.messages     # [{'severity': 'warning', 'code': 'exit', ...}]
+        d.counts       # {'exit': 1}
+
+    At most limit messages of each code are kept (DIAG_BUFFER_SIZE in
+    all), the others are only counted.  case_id is copied to the
+    messages, it can be changed between the solves.  The results carry
+    the same diagnostics without a Diagnostics, see the warnings of
+    Equilibrium and RocketPerformance.
+    '''
+
+    def __init__(self, limit=10, case_id=0):
+        super(Diagnostics, self).__init__()
+        self._sink = ffi.new("diag_sink_t *")
+        lib.diag_init(self._sink, limit, ffi.NULL)
+        self._sink.case_id = case_id
+        self._previous = None
+
+    def __enter__(self):
+        self._previous = lib.diag_attach(self._sink)
+        return self
+
+    def __exit__(self, *exc):
+        lib.diag_attach(self._previous)
+        self._previous = None
+        return False
+
+    @property
+    def case_id(self):
+        return self._sink.case_id
+
+    @case_id.setter
+    def case_id(self, value):
+        self._sink.case_id = value
+
+    @property
+    def messages(self):
+        '''
+        The messages kept, dicts of severity, code, case, value and
+        message.
+        '''
+        return [{'severity': ffi.string(
+                     lib.diag_severity_name(m.severity)).decode('utf-8'),
+                 'code': ffi.string(lib.diag_name(m.code)).decode('utf-8'),
+                 'case': m.case_id,
+                 'value': m.value,
+                 'message': ffi.string(lib.diag_text(m.code)).decode('utf-8')}
+                for m in (self._sink.message[i]
+                          for i in range(self._sink.n_message))]
+
+    @property
+    def counts(self):
+        '''
+        Number of diagnostics raised of each code, kept or not.
+        '''
+        return dict((ffi.string(lib.diag_name(i)).decode('utf-8'),
+                     self._sink.count[i])
+                    for i in range(lib.DIAG_LAST) if self._sink.count[i] > 0)
+
+    def clear(self):
+        '''
+        Forgets the messages and the counts.
+        '''
+        lib.diag_clear(self._sink)
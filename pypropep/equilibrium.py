@@ -2,26 +2,98 @@ import re
 import numpy as np
 import operator
 from .cpropep._cpropep import ffi, lib
-from .error import RET_ERRORS
+from .error import RET_ERRORS, solver_error
+from .species import species_names
+from .pool import pooled_equilibrium, release
+from .diagnostics import warning_names
 
 __all__ = ['Equilibrium']
 
+_STATS_FIELDS = ('iterations', 'restarts', 'lu', 'singular', 'inserted',
+                 'removed', 'lambda', 'time', 'warnings')
+
+def _stats_dict(stats):
+    # Copy of a solver_stats_t, which is overwritten by the next solve
+    return dict((f, getattr(stats, f)) for f in _STATS_FIELDS)
+
 class Equilibrium(object):
     def __init__(self, equilibrium_t_ptr=None):
         super(Equilibrium, self).__init__()
         if equilibrium_t_ptr is not None:
             self._equil = equilibrium_t_ptr
+            self._pooled = False
+            lib.initialize_equilibrium(self._equil)
         else:
-            self._equil = ffi.new("equilibrium_t *")
-        lib.initialize_equilibrium(self._equil)
+            self._equil = pooled_equilibrium()
+            self._pooled = True
         self.reset()
 
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.release()
+
+    def release(self):
+        '''
+        Gives the native buffer back to the pool now rather than when the
+        object is garbage collected.  The object must not be used after.
+        '''
+        if self._pooled and self._equil is not None:
+            release(self._equil)
+        self._equil = None
+
     def reset(self):
         lib.reset_equilibrium(self._equil)
-        self._composition = dict()
-        self._composition_condensed = dict()
+        self._composition = None
+        self._composition_sorted = None
+        self._composition_condensed = None
         self.propellants = []
 
+    def clear(self):
+        '''
+        Removes the propellants and the computed state so the object can
+        be reused for another mixture.
+        '''
+        lib.initialize_equilibrium(self._equil)
+        self.reset()
+
+    def save(self):
+        '''
+        Returns a compact binary snapshot of the state (composition,
+        product list, mol numbers, properties and performance).  It can
+        only be restored by the same build with the same loaded data.
+        '''
+        size = lib.equilibrium_snapshot_size(self._equil)
+        buf = ffi.new("char[]", size)
+        n = lib.save_equilibrium(self._equil, buf, size)
+        if n < 0:
+            raise RuntimeError("Saving the equilibrium failed with {}".format(
+                RET_ERRORS[n]))
+        return ffi.buffer(buf, n)[:]
+
+    def restore(self, snapshot):
+        '''
+        Restores a state returned by save().  The elements and products are
+        not listed again and the next set_state starts from this state.
+        '''
+        err = lib.restore_equilibrium(self._equil, snapshot, len(snapshot))
+        if err < 0:
+            raise RuntimeError("Restoring the equilibrium failed with {}"
+                               .format(RET_ERRORS[err]))
+        self._composition = None
+        self._composition_sorted = None
+        self._composition_condensed = None
+
+    def __getstate__(self):
+        return {'snapshot': self.save(), 'propellants': self.propellants}
+
+    def __setstate__(self, state):
+        self._equil = pooled_equilibrium()
+        self._pooled = True
+        self.restore(state['snapshot'])
+        self.propellants = state['propellants']
+
     def __del__(self):
         del self._equil
 
@@ -84,45 +156,114 @@ class Equilibrium(object):
     def properties(self):
         return self._equil.properties
 
+    @property
+    def stats(self):
+        '''
+        Work done by the last equilibrium computation: Newton iterations,
+        restarts, LU solves, LU solves on a singular matrix, condensed species
+        inserted and removed, last damping factor, wall time (s) and
+        the mask of the diagnostics raised (see warnings).
+        '''
+        return _stats_dict(self._equil.stats)
+
+    @property
+    def warnings(self):
+        '''
+        Names of the diagnostics raised by the last equilibrium
+        computation, e.g. ['singular'] if a singular matrix was
+        recovered by removing condensed species.
+        '''
+        return warning_names(self._equil.stats.warnings)
+
+    def _view(self, state, field, dtype):
+        # Zero-copy view of the first n[state] entries of a product array,
+        # valid as long as this object is alive
+        n = self._equil.product.n[state]
+        array = getattr(self._equil.product, field)[state]
+        return np.frombuffer(ffi.buffer(array), dtype=dtype, count=n)
+
+    @property
+    def species_ids(self):
+        '''
+        Index in the thermo data of each gaseous product, as a numpy view.
+        '''
+        return self._view(lib.GAS, 'species', np.int16)
+
+    @property
+    def species_ids_condensed(self):
+        return self._view(lib.CONDENSED, 'species', np.int16)
+
+    @property
+    def moles(self):
+        '''
+        Moles per gram of mixture of each gaseous product, as a numpy view
+        over the solver state.  It follows the order of species_ids.
+        '''
+        return self._view(lib.GAS, 'coef', np.float64)
+
+    @property
+    def moles_condensed(self):
+        return self._view(lib.CONDENSED, 'coef', np.float64)
+
+    def _total_moles(self):
+        return self._equil.itn.n + self.moles_condensed.sum()
+
+    @property
+    def molar_fractions(self):
+        if self.equilibrated is False:
+            return None
+        return self.moles / self._total_moles()
+
+    @property
+    def molar_fractions_condensed(self):
+        if self.equilibrated is False:
+            return None
+        return self.moles_condensed / self._total_moles()
+
     @property
     def composition(self):
         if self.equilibrated is False:
             return None
+        if self._composition is None:
+            names = species_names()
+            self._composition = dict(zip(
+                [names[i] for i in self.species_ids],
+                self.molar_fractions.tolist()))
         return self._composition
 
     @property
     def composition_sorted(self):
         if self.equilibrated is False:
             return None
-        return sorted(list(self._composition.items()), key=operator.itemgetter(1),
-                      reverse=True)
+        if self._composition_sorted is None:
+            self._composition_sorted = sorted(
+                list(self.composition.items()),
+                key=operator.itemgetter(1), reverse=True)
+        return self._composition_sorted
 
     @property
     def composition_condensed(self):
         if self.equilibrated is False:
             return None
+        if self._composition_condensed is None:
+            names = species_names()
+            self._composition_condensed = dict(zip(
+                [names[i] for i in self.species_ids_condensed],
+                self.molar_fractions_condensed.tolist()))
         return self._composition_condensed
 
 
     def _compute_product_composition(self):
+        '''
+        Marks the composition dictionaries out of date, they are built
+        again from the solver state when they are next requested.
+        '''
         if self.equilibrated is False:
             raise RuntimeError("Can't compute product composition until \
                                equilibrum is computed")
-        mol_g = self._equil.itn.n
-        for i in range(self._equil.product.n[lib.CONDENSED]):
-            mol_g += self._equil.product.coef[lib.CONDENSED][i]
-
-        for i in range(self._equil.product.n[lib.GAS]):
-            ind = self._equil.product.species[lib.GAS][i]
-            name = ffi.string(lib.thermo_list[ind].name).decode('utf-8')
-            self._composition[name] = \
-                self._equil.product.coef[lib.GAS][i] / mol_g
-
-        for i in range(self._equil.product.n[lib.CONDENSED]):
-            ind = self._equil.product.species[lib.CONDENSED][i]
-            name = ffi.string(lib.thermo_list[ind].name).decode('utf-8')
-            self._composition_condensed[name] = \
-                self._equil.product.coef[lib.CONDENSED][i] / mol_g
+        self._composition = None
+        self._composition_sorted = None
+        self._composition_condensed = None
 
     def set_state(self, P, T=None, type='HP'):
         '''
@@ -152,10 +293,9 @@ class Equilibrium(object):
         else:
             raise ValueError("set_state: type must be one of ('TP', 'SP', 'HP')!")
 
-        err = lib.equilibrium(self._equil, eq_type)
+        err = lib.disk_cached_equilibrium(self._equil, eq_type)
         if err != 0:
-            raise RuntimeError("Equilibrium failed with error: '{}'".format(
-                                RET_ERRORS[err]))
+            raise solver_error("Equilibrium failed with error: '{}'", err)
 
         self._compute_product_composition()
 
@@ -7,5 +7,28 @@ RET_ERRORS = {
     -6: "Equlibrium error",
     -7: "Area ratio error",
     -8: "Ratio type error",
-    -9: "Too many equilibrium iterations"
+    -9: "Too many equilibrium iterations",
+    -10: "Buffer full",
+    -11: "Bad snapshot",
+    -12: "Work budget exhausted"
 }
+
+ERR_BUDGET = -12
+
+
+class BudgetExhausted(RuntimeError):
+    '''
+    Raised when a solver stopped on the limits of the Budget of the
+    thread.  The properties keep the state of the last iteration.
+    '''
+    pass
+
+
+def solver_error(message, err):
+    '''
+    Exception for the error code err of a solver, the text of the error
+    is formatted in message.
+    '''
+    if err == ERR_BUDGET:
+        return BudgetExhausted(message.format(RET_ERRORS[err]))
+    return RuntimeError(message.format(RET_ERRORS[err]))
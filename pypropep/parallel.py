@@ -0,0 +1,70 @@
+import threading
+from concurrent.futures import ThreadPoolExecutor
+from .equilibrium import Equilibrium
+from .performance import FrozenPerformance, ShiftingPerformance
+
+__all__ = ['Context', 'thread_context', 'parallel_map']
+
+
+class Context(object):
+    '''
+    Native objects owned by one thread.  Each accessor clears and returns
+    the same object every time, so the jobs run by a thread reuse its
+    buffers instead of allocating new ones.
+    '''
+    def __init__(self):
+        super(Context, self).__init__()
+        self._objects = dict()
+
+    def _get(self, cls):
+        obj = self._objects.get(cls)
+        if obj is None:
+            obj = self._objects[cls] = cls()
+        else:
+            obj.clear()
+        return obj
+
+    def equilibrium(self):
+        return self._get(Equilibrium)
+
+    def frozen_performance(self):
+        return self._get(FrozenPerformance)
+
+    def shifting_performance(self):
+        return self._get(ShiftingPerformance)
+
+
+_local = threading.local()
+
+
+def thread_context():
+    '''
+    Returns the Context of the calling thread.
+    '''
+    context = getattr(_local, 'context', None)
+    if context is None:
+        context = _local.context = Context()
+    return context
+
+
+def parallel_map(func, jobs, workers=None):
+    '''
+    Runs func(context, job) for each job on a pool of threads and returns
+    the results in the order of jobs.  context is the Context of the
+    thread running the job, its objects must not be kept after func
+    returns.  The solver runs without the GIL and the loaded data is
+    shared by all the threads, init() must not be called while the jobs
+    run.  Example:
+        def isp(context, OF):
+            p = context.shifting_performance()
+            p.add_propellants_by_mass([(ch4, 1.0), (o2, OF)])
+            p.set_state(P=50., Pe=1.)
+            return p.performance.Isp
+
+        parallel_map(isp, np.linspace(2., 4., 21), workers=4)
+    '''
+    def run(job):
+        return func(thread_context(), job)
+
+    with ThreadPoolExecutor(max_workers=workers) as executor:
+        return list(executor.map(run, jobs))
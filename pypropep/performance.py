@@ -1,12 +1,24 @@
 import re
+import numpy as np
 from .cpropep._cpropep import ffi, lib
-from pypropep.equilibrium import Equilibrium
-from pypropep.error import RET_ERRORS
+from pypropep.equilibrium import Equilibrium, _stats_dict
+from pypropep.diagnostics import warning_names
+from pypropep.error import RET_ERRORS, solver_error
+from pypropep.species import species_names
+from pypropep.pool import pooled_equilibrium, release
 
 __all__ = ['RocketPerformance', 'FrozenPerformance', 'ShiftingPerformance']
 
 Ge = 9.80665
 
+EXIT_CONDITIONS = {
+    'Pe': lib.PRESSURE,
+    'Ae_At': lib.SUPERSONIC_AREA_RATIO,
+    'Ae_At_subsonic': lib.SUBSONIC_AREA_RATIO
+}
+
+NOZZLE_FIELDS = ['ae_at', 'T', 'P', 'rho', 'mach', 'gamma', 'a', 'u']
+
 class RocketPerformance(object):
     '''
     A generic container class for cpropep case's.
@@ -15,11 +27,61 @@ class RocketPerformance(object):
     '''
     def __init__(self, T=300., P=1.):
         super(RocketPerformance, self).__init__()
-        self._equil_structs = ffi.new("equilibrium_t[3]")
-        self._equil_objs = list()
-        for i in range(3):
-            e = ffi.addressof(self._equil_structs[i])
-            self._equil_objs.append(Equilibrium(e))
+        self._allocate_stations(3)
+
+    def _allocate_stations(self, n):
+        '''
+        Allocates n equilibrium structs (chamber, throat and n - 2 exit
+        stations).  The propellant composition of the chamber is kept.
+        '''
+        structs = pooled_equilibrium(n)
+        objs = list()
+        for i in range(n):
+            e = ffi.addressof(structs[i])
+            objs.append(Equilibrium(e))
+
+        if getattr(self, '_equil_structs', None) is not None:
+            lib.copy_equilibrium(ffi.addressof(structs[0]),
+                                 ffi.addressof(self._equil_structs[0]))
+            objs[0].propellants = self._equil_objs[0].propellants
+
+        self._equil_structs = structs
+        self._equil_objs = objs
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.release()
+
+    def release(self):
+        '''
+        Gives the native buffers back to the pool now rather than when the
+        object is garbage collected.  The object must not be used after.
+        '''
+        if self._equil_structs is not None:
+            release(self._equil_structs)
+        self._equil_structs = None
+        self._equil_objs = None
+
+    def clear(self):
+        '''
+        Removes the propellants and the computed state so the object can
+        be reused for another mixture.
+        '''
+        self._equil_objs[0].clear()
+        for e in self._equil_objs[1:]:
+            e.reset()
+
+    def __getstate__(self):
+        return {'snapshots': [e.save() for e in self._equil_objs],
+                'propellants': self._equil_objs[0].propellants}
+
+    def __setstate__(self, state):
+        self._allocate_stations(len(state['snapshots']))
+        for e, snapshot in zip(self._equil_objs, state['snapshots']):
+            e.restore(snapshot)
+        self._equil_objs[0].propellants = state['propellants']
 
     @property
     def equilibrated(self):
@@ -45,7 +107,27 @@ class RocketPerformance(object):
 
     @property
     def properties(self):
-        return [p.properties for p in self._equil_structs]
+        return [self._equil_structs[i].properties
+                for i in range(len(self._equil_objs))]
+
+    @property
+    def stats(self):
+        '''
+        Solver statistics of each station (chamber, throat, exits), see
+        Equilibrium.stats. The throat and exit entries sum the equilibrium
+        computations done while searching the station pressure.
+        '''
+        return [_stats_dict(self._equil_structs[i].stats)
+                for i in range(len(self._equil_objs))]
+
+    @property
+    def warnings(self):
+        '''
+        Names of the diagnostics raised at each station, see
+        Equilibrium.warnings.
+        '''
+        return [warning_names(self._equil_structs[i].stats.warnings)
+                for i in range(len(self._equil_objs))]
 
     @property
     def composition(self):
@@ -67,6 +149,25 @@ class RocketPerformance(object):
     def performance(self):
         return self._equil_structs[2].performance
 
+    @property
+    def throat_performance(self):
+        '''
+        Performance at the throat, its residual is the one reached on the
+        sonic condition, |u^2 - a^2| / u^2.
+        '''
+        return self._equil_structs[1].performance
+
+    @property
+    def exit_performance(self):
+        '''
+        Performance of every exit station computed by the last call to
+        set_state or set_state_multi, in the order of the exit conditions.
+        For an area ratio, iterations is the number of states computed to
+        find the exit pressure and residual is |ln(Ae/At) - ln(ae_at)|.
+        '''
+        return [self._equil_structs[i].performance
+                for i in range(2, len(self._equil_objs))]
+
 
     def add_propellant(self, propellant, mol):
         '''
@@ -104,6 +205,152 @@ class RocketPerformance(object):
             propellant_list_by_mol.append((p, N))
         self.add_propellants(propellant_list_by_mol)
 
+    def _exit_conditions(self, exit_conditions):
+        n = len(exit_conditions)
+        if n == 0:
+            raise RuntimeError("At least one exit condition must be specified")
+
+        exit_types = ffi.new("exit_condition_t[]", n)
+        values = ffi.new("double[]", n)
+        for i, (kind, value) in enumerate(exit_conditions):
+            if kind not in EXIT_CONDITIONS:
+                raise ValueError("Exit condition must be one of {}".format(
+                    tuple(EXIT_CONDITIONS.keys())))
+            exit_types[i] = EXIT_CONDITIONS[kind]
+            values[i] = value
+        return exit_types, values
+
+    def set_state_multi(self, P, exit_conditions):
+        '''
+        Computes the performance for several exit conditions at once, the
+        chamber and throat are only solved one time.  exit_conditions is a
+        list of (kind, value) tuples where kind is one of 'Pe', 'Ae_At' or
+        'Ae_At_subsonic'.  Example:
+            set_state_multi(P=50., exit_conditions=[
+                            ('Ae_At_subsonic', 2.), ('Pe', 1.),
+                            ('Ae_At', 10.), ('Ae_At', 40.)])
+        Returns the list of exit performance, one per exit condition.
+        '''
+        n = len(exit_conditions)
+        exit_types, values = self._exit_conditions(exit_conditions)
+
+        if len(self._equil_objs) != n + 2:
+            self._allocate_stations(n + 2)
+
+        # The chamber is solved again, or taken from the equilibrium cache
+        self._equil_structs[0].properties.P = P
+        self._equil_structs[0].product.isequil = False
+        err = self._performance_multi(self._equil_structs, n, exit_types,
+                                      values)
+        if err < 0:
+            raise solver_error(self._name + " failed with {}", err)
+
+        RocketPerformance.set_state(self)
+        return self.exit_performance
+
+    def ambient_performance(self, Pa=None, altitude=None, station=0):
+        '''
+        Thrust coefficient and delivered specific impulse (m/s) of an exit
+        station for an array of ambient pressures Pa (atm), or of altitudes
+        (m) in the U.S. Standard Atmosphere 1976.  station is the index in
+        the exit conditions of the last set_state or set_state_multi,
+        ValueError is raised if there is no such station.  Returns a numpy
+        structured array with fields Pa, cf, Isp and separated, the later
+        flags the over-expanded points where the flow would separate from
+        the nozzle wall.
+        '''
+        if (Pa is None) == (altitude is None):
+            raise RuntimeError("One of Pa or altitude must be specified")
+
+        n_exit = len(self._equil_objs) - 2
+        if not 0 <= station < n_exit:
+            raise ValueError("station must be in [0, {})".format(n_exit))
+        ex = ffi.addressof(self._equil_structs[2 + station])
+
+        if altitude is not None:
+            h = np.ascontiguousarray(altitude, dtype=np.float64).ravel()
+            pa = np.empty_like(h)
+        else:
+            pa = np.ascontiguousarray(Pa, dtype=np.float64).ravel()
+
+        result = np.zeros(pa.size, dtype=[('Pa', np.float64),
+                                          ('cf', np.float64),
+                                          ('Isp', np.float64),
+                                          ('separated', np.bool_)])
+        cf = np.empty_like(pa)
+        isp = np.empty_like(pa)
+        separated = np.empty(pa.size, dtype=np.intc)
+        out = (ffi.cast("double *", ffi.from_buffer(cf)),
+               ffi.cast("double *", ffi.from_buffer(isp)),
+               ffi.cast("int *", ffi.from_buffer(separated)))
+
+        if altitude is not None:
+            err = lib.altitude_performance(
+                ex, h.size, ffi.cast("double *", ffi.from_buffer(h)),
+                ffi.cast("double *", ffi.from_buffer(pa)), *out)
+        else:
+            err = lib.ambient_performance(
+                ex, pa.size, ffi.cast("double *", ffi.from_buffer(pa)), *out)
+        if err < 0:
+            raise RuntimeError("Ambient performance failed with {}".format(
+                RET_ERRORS[err]))
+
+        result['Pa'] = pa
+        result['cf'] = cf
+        result['Isp'] = isp
+        result['separated'] = separated
+        return result
+
+    def nozzle_profile(self, P, stations):
+        '''
+        Marches in the nozzle from the chamber to the exit, each station
+        starting from the previous one.  stations is a list of
+        (kind, value) tuples as for set_state_multi, in the order of the
+        expansion.  Returns a numpy structured array with one record for
+        the chamber, each subsonic station, the throat and each supersonic
+        station.  The fields are ae_at, T, P, rho, mach, gamma, a, u and
+        the molar fraction of each product species.
+        '''
+        exit_types, values = self._exit_conditions(stations)
+
+        if len(self._equil_objs) != 3:
+            self._allocate_stations(3)
+
+        # The chamber is solved first to know the product list
+        chamber = ffi.addressof(self._equil_structs[0])
+        chamber.properties.P = P
+        chamber.product.isequil = False
+        err = lib.cached_equilibrium(chamber, lib.HP)
+        if err < 0:
+            raise solver_error(self._name + " failed with {}", err)
+
+        n_species = lib.nozzle_buffer_columns(chamber)
+        data = np.zeros((len(stations) + 2, lib.NOZZLE_NVAR + n_species))
+        species = ffi.new("short[]", max(n_species, 1))
+        buf = ffi.new("nozzle_buffer_t *")
+        buf.size = data.shape[0]
+        buf.n_species = n_species
+        buf.species = species
+        buf.data = ffi.cast("double *", ffi.from_buffer(data))
+
+        err = self._nozzle_profile(self._equil_structs, len(stations),
+                                   exit_types, values,
+                                   ffi.addressof(lib, 'nozzle_buffer_sink'),
+                                   buf)
+        if err < 0:
+            raise solver_error(self._name + " failed with {}", err)
+
+        names = list(NOZZLE_FIELDS)
+        all_names = species_names()
+        for i in range(n_species):
+            name = all_names[species[i]]
+            while name in names:
+                name += "'"
+            names.append(name)
+
+        dtype = np.dtype([(name, np.float64) for name in names])
+        return data.view(dtype)[:, 0]
+
     def set_state(self):
         for e in self._equil_objs:
             e._compute_product_composition()
@@ -137,6 +384,10 @@ class RocketPerformance(object):
         return s
 
 class FrozenPerformance(RocketPerformance):
+    _performance_multi = lib.disk_cached_frozen_performance
+    _nozzle_profile = lib.frozen_nozzle_profile
+    _name = "Frozen performance"
+
     def __init__(self, *args):
         super(FrozenPerformance, self).__init__(*args)
 
@@ -144,27 +395,21 @@ class FrozenPerformance(RocketPerformance):
         if (Pe is not None) and (Ae_At is not None):
             raise RuntimeError("Only one of Pe or At_Ae may be set at a time")
 
-        self._equil_structs[0].properties.P = P
-
         if (Pe is None) and (Ae_At is None):
             raise RuntimeError("At least one of Pe or Ae_At must be specified")
         elif Pe is not None:
-            err = lib.frozen_performance(ffi.addressof(self._equil_structs[0]),
-                                         lib.PRESSURE, Pe)
-        elif Ae_At is not None:
-            err = lib.frozen_performance(ffi.addressof(self._equil_structs[0]),
-                                         lib.SUPERSONIC_AREA_RATIO, Ae_At)
+            exit_condition = ('Pe', Pe)
         else:
-            raise RuntimeError("Shouldn't have gotten here")
+            exit_condition = ('Ae_At', Ae_At)
 
-        if err < 0:
-            raise RuntimeError("Frozen performance failed with {}".format(
-                RET_ERRORS[err]))
-
-        super(FrozenPerformance, self).set_state()
+        self.set_state_multi(P, [exit_condition])
 
 
 class ShiftingPerformance(RocketPerformance):
+    _performance_multi = lib.disk_cached_shifting_performance
+    _nozzle_profile = lib.shifting_nozzle_profile
+    _name = "Shifting performance"
+
     def __init__(self, *args):
         super(ShiftingPerformance, self).__init__(*args)
 
@@ -172,21 +417,11 @@ class ShiftingPerformance(RocketPerformance):
         if (Pe is not None) and (Ae_At is not None):
             raise RuntimeError("Only one of Pe or At_Ae may be set at a time")
 
-        self._equil_structs[0].properties.P = P
-
         if (Pe is None) and (Ae_At is None):
             raise RuntimeError("At least one of Pe or Ae_At must be specified")
         elif Pe is not None:
-            err = lib.shifting_performance(ffi.addressof(self._equil_structs[0]),
-                                         lib.PRESSURE, Pe)
-        elif Ae_At is not None:
-            err = lib.shifting_performance(ffi.addressof(self._equil_structs[0]),
-                                         lib.SUPERSONIC_AREA_RATIO, Ae_At)
+            exit_condition = ('Pe', Pe)
         else:
-            raise RuntimeError("Shouldn't have gotten here")
-
-        if err < 0:
-            raise RuntimeError("Frozen performance failed with {}".format(
-                RET_ERRORS[err]))
+            exit_condition = ('Ae_At', Ae_At)
 
-        super(ShiftingPerformance, self).set_state()
+        self.set_state_multi(P, [exit_condition])
@@ -0,0 +1,43 @@
+from .cpropep._cpropep import ffi, lib
+
+__all__ = ['pooled_equilibrium', 'release', 'pool_stats', 'trim_pool']
+
+
+def pooled_equilibrium(n=1):
+    '''
+    Returns a block of n initialized equilibrium_t from the native pool.
+    The block goes back to the pool when it is garbage collected or given
+    to release().
+    '''
+    e = lib.equilibrium_pool_get(n)
+    if e == ffi.NULL:
+        raise MemoryError("No memory for {} equilibrium_t".format(n))
+    return ffi.gc(e, lambda e: lib.equilibrium_pool_release(e, n))
+
+
+def release(block):
+    '''
+    Gives a block of pooled_equilibrium() back to the pool now, it must
+    not be used after.
+    '''
+    ffi.release(block)
+
+
+def pool_stats():
+    '''
+    Returns a dict with the number of blocks allocated and recycled by the
+    pool, and of blocks currently free in it.
+    '''
+    allocated = ffi.new("unsigned long *")
+    recycled = ffi.new("unsigned long *")
+    free_blocks = ffi.new("unsigned long *")
+    lib.equilibrium_pool_stats(allocated, recycled, free_blocks)
+    return {'allocated': allocated[0], 'recycled': recycled[0],
+            'free': free_blocks[0]}
+
+
+def trim_pool():
+    '''
+    Frees the memory of the blocks kept in the pool.
+    '''
+    lib.equilibrium_pool_trim()
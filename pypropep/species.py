@@ -0,0 +1,33 @@
+import sys
+from .cpropep._cpropep import ffi, lib
+
+__all__ = ['species_names', 'propellant_names']
+
+_names = {}
+
+
+def _load_names(table, count):
+    # The names are interned once per loaded data
+    version, names = _names.get(table, (None, None))
+    if version != lib.database_version:
+        records = getattr(lib, table)
+        names = [sys.intern(ffi.string(records[i].name).decode('utf-8'))
+                 for i in range(count)]
+        _names[table] = (lib.database_version, names)
+    return names
+
+
+def species_names():
+    '''
+    List of the species names indexed by their position in the thermo
+    data.
+    '''
+    return _load_names('thermo_list', lib.num_thermo)
+
+
+def propellant_names():
+    '''
+    List of the propellant names indexed by their position in the
+    propellant data.
+    '''
+    return _load_names('propellant_list', lib.num_propellant)
@@ -0,0 +1,105 @@
+import numpy as np
+from .cpropep._cpropep import ffi, lib
+from .error import RET_ERRORS
+from .species import species_names
+from .pool import pooled_equilibrium
+from .performance import EXIT_CONDITIONS
+
+__all__ = ['sweep']
+
+STATION_FIELDS = ['P', 'T', 'H', 'S', 'M', 'Cp', 'gamma', 'Vson']
+PERFORMANCE_FIELDS = ['ae_at', 'a_dotm', 'cstar', 'cf', 'Ivac', 'Isp']
+
+
+def _composition(propellant_list):
+    '''
+    Fills a composition_t from a list of (propellant, mass) tuples.
+    '''
+    if len(propellant_list) == 0:
+        raise ValueError("At least one propellant must be specified")
+
+    c = ffi.new("composition_t *")
+    c.ncomp = len(propellant_list)
+    for i, (p, mass) in enumerate(propellant_list):
+        c.molecule[i] = p['id']
+        c.coef[i] = mass / lib.propellant_molar_mass(p['id'])
+    return c
+
+
+def sweep(fuel, oxidizer, OF, P, Pe=None, Ae_At=None, frozen=False):
+    '''
+    Computes the rocket performance for arrays of mixture ratio and
+    chamber pressure in a single native call.  fuel and oxidizer are lists
+    of (propellant, mass) tuples giving the mass fractions inside each of
+    them, OF is the oxidizer / fuel mass ratio and P the chamber pressure
+    (atm).  One of Pe (atm) or Ae_At sets the exit condition.  OF, P and
+    the exit condition are broadcast together.  Example:
+        sweep([(pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)'], 1.)],
+              [(pypropep.PROPELLANTS['OXYGEN (LIQUID)'], 1.)],
+              OF=np.linspace(4., 8., 41), P=[[50.], [100.]], Ae_At=40.)
+    Returns a numpy structured array of the broadcast shape.  The fields
+    are OF, the chamber_, throat_ and exit_ prefixed P, T, H, S, M, Cp,
+    gamma and Vson, then ae_at, a_dotm, cstar, cf, Ivac, Isp and the exit
+    molar fraction of each product species.  The fields of the points
+    that failed are NaN.
+    '''
+    if (Pe is not None) and (Ae_At is not None):
+        raise RuntimeError("Only one of Pe or At_Ae may be set at a time")
+    if (Pe is None) and (Ae_At is None):
+        raise RuntimeError("At least one of Pe or Ae_At must be specified")
+    elif Pe is not None:
+        exit_type = EXIT_CONDITIONS['Pe']
+        value = Pe
+    else:
+        exit_type = EXIT_CONDITIONS['Ae_At']
+        value = Ae_At
+
+    OF, P, value = np.broadcast_arrays(np.asarray(OF, dtype=np.float64),
+                                       np.asarray(P, dtype=np.float64),
+                                       np.asarray(value, dtype=np.float64))
+    shape = OF.shape
+    of = np.ascontiguousarray(OF).ravel()
+    pc = np.ascontiguousarray(P).ravel()
+    value = np.ascontiguousarray(value).ravel()
+    n = of.size
+
+    f = _composition(fuel)
+    o = _composition(oxidizer)
+
+    e = pooled_equilibrium(3)
+    n_species = lib.sweep_columns(e, f, o)
+    if n_species < 0:
+        raise RuntimeError("Sweep failed with {}".format(
+            RET_ERRORS[n_species]))
+
+    data = np.zeros((n, lib.SWEEP_NVAR + n_species))
+    status = np.zeros(n, dtype=np.intc)
+    species = ffi.new("short[]", max(n_species, 1))
+
+    run = lib.frozen_performance_sweep if frozen else \
+        lib.shifting_performance_sweep
+    err = run(e, f, o, n,
+              ffi.cast("double *", ffi.from_buffer(of)),
+              ffi.cast("double *", ffi.from_buffer(pc)), exit_type,
+              ffi.cast("double *", ffi.from_buffer(value)),
+              n_species, species,
+              ffi.cast("double *", ffi.from_buffer(data)),
+              ffi.cast("int *", ffi.from_buffer(status)))
+    if err < 0:
+        raise RuntimeError("Sweep failed with {}".format(RET_ERRORS[err]))
+
+    data[status < 0] = np.nan
+
+    names = ['OF']
+    for station in ['chamber', 'throat', 'exit']:
+        names += [station + '_' + field for field in STATION_FIELDS]
+    names += PERFORMANCE_FIELDS
+    all_names = species_names()
+    for i in range(n_species):
+        name = all_names[species[i]]
+        while name in names:
+            name += "'"
+        names.append(name)
+
+    dtype = np.dtype([(name, np.float64) for name in names])
+    return data.view(dtype)[:, 0].reshape(shape)
@@ -0,0 +1,66 @@
+try:
+    from collections.abc import Mapping
+except ImportError:
+    from collections import Mapping
+
+__all__ = ['Table']
+
+
+class Table(Mapping):
+    '''
+    Read-only mapping from name to entry of one of the C data tables.
+    A name given to several entries is followed by one ' per previous
+    entry of the same name ('Cr2O3(I)', "Cr2O3(I)'", ...).  Names are
+    resolved by a binary search in the native name index and an entry is
+    only converted to Python the first time it is requested.
+    '''
+    def __init__(self, count, names, lookup, make):
+        super(Table, self).__init__()
+        self._count = count
+        self._names = names
+        self._lookup = lookup
+        self._make = make
+        self._entries = dict()
+        self._keys = None
+
+    def index(self, key):
+        '''
+        Position of the entry key in the C table, raises KeyError if there
+        is none.
+        '''
+        try:
+            name = key.rstrip("'")
+            i = self._lookup(name.encode('utf-8'), len(key) - len(name))
+        except (AttributeError, TypeError):
+            raise KeyError(key)
+        if i < 0:
+            raise KeyError(key)
+        return i
+
+    def __getitem__(self, key):
+        entry = self._entries.get(key)
+        if entry is None:
+            entry = self._make(self.index(key))
+            self._entries[key] = entry
+        return entry
+
+    def __contains__(self, key):
+        try:
+            self.index(key)
+        except KeyError:
+            return False
+        return True
+
+    def __len__(self):
+        return self._count()
+
+    def __iter__(self):
+        if self._keys is None:
+            seen = dict()
+            keys = []
+            for name in self._names():
+                n = seen.get(name, 0)
+                seen[name] = n + 1
+                keys.append(name + "'" * n)
+            self._keys = keys
+        return iter(self._keys)
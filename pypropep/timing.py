@@ -0,0 +1,105 @@
+from .cpropep._cpropep import ffi, lib
+from .error import RET_ERRORS
+
+__all__ = ['TimingStats', 'timing_stats', 'reset_timing', 'timing_enabled',
+           'timeline_enabled', 'write_timeline', 'reset_timeline']
+
+
+class TimingStats(object):
+    '''
+    Time spent in each phase of the computation since the last
+    reset_timing(): loading of the data, listing of the products,
+    chamber equilibrium, throat and exit iterations and derivative().
+    The phases nest, derivative() is also counted in the phase that
+    solved the equilibrium.
+
+    stats['chamber'] is a dict with the number of runs (count) and the
+    total, mean and max time of the phase in seconds.
+    '''
+
+    def __init__(self):
+        stats = ffi.new("timer_stat_t[]", lib.TIMER_LAST)
+        lib.timer_stats(stats)
+        self.phases = {}
+        for i in range(lib.TIMER_LAST):
+            s = stats[i]
+            name = ffi.string(lib.timer_name(i)).decode('utf-8')
+            self.phases[name] = {
+                'count': s.count,
+                'total': s.total,
+                'mean': s.total / s.count if s.count > 0 else 0.0,
+                'max': s.max}
+
+    def __getitem__(self, phase):
+        return self.phases[phase]
+
+    def __iter__(self):
+        return iter(self.phases)
+
+    def __repr__(self):
+        lines = ["{:<10} {:>9} {:>12} {:>12} {:>12}".format(
+            "Phase", "Count", "Total (ms)", "Mean (us)", "Max (us)")]
+        for name, s in self.phases.items():
+            lines.append("{:<10} {:>9d} {:>12.3f} {:>12.3f} {:>12.3f}".format(
+                name, s['count'], 1e3 * s['total'], 1e6 * s['mean'],
+                1e6 * s['max']))
+        return "\n".join(lines)
+
+
+def timing_stats():
+    '''
+    Returns a TimingStats of the phases timed so far.
+    '''
+    return TimingStats()
+
+
+def reset_timing():
+    '''
+    Sets the time and the count of every phase back to zero.
+    '''
+    lib.timer_reset()
+
+
+def timing_enabled():
+    '''
+    True if the library was compiled with the timers (TIMING defined),
+    the statistics stay at zero otherwise.
+    '''
+    return bool(lib.timer_enabled())
+
+
+def timeline_enabled():
+    '''
+    True if the library was compiled with the timeline (TIMELINE
+    defined, PYPROPEP_TIMELINE=1 when building), no event is recorded
+    otherwise.
+    '''
+    return bool(lib.timeline_enabled())
+
+
+def write_timeline(filename):
+    '''
+    Writes the equilibria, Newton iterations, LU solves, condensed
+    species changes and throat and exit iterations recorded by each
+    thread in filename, in the Chrome trace event format opened by
+    chrome://tracing or ui.perfetto.dev.  Each thread is a lane, which
+    shows the load of the threads of parallel_map.  Must be called
+    while no solver is running.  Returns a dict with the number of
+    events recorded and dropped (overwritten in the ring of a thread).
+    '''
+    err = lib.timeline_write(filename.encode('utf-8'))
+    if err < 0:
+        raise RuntimeError("Writing the timeline {} failed with {}".format(
+            filename, RET_ERRORS[err]))
+    recorded = ffi.new("unsigned long *")
+    dropped = ffi.new("unsigned long *")
+    lib.timeline_stats(recorded, dropped)
+    return {'recorded': recorded[0], 'dropped': dropped[0]}
+
+
+def reset_timeline():
+    '''
+    Forgets the events recorded so far, must be called while no
+    solver is running.
+    '''
+    lib.timeline_reset()
@@ -0,0 +1,41 @@
+from .cpropep._cpropep import ffi, lib
+from .error import RET_ERRORS
+
+__all__ = ['start_trace', 'stop_trace', 'trace_stats']
+
+
+def start_trace(filename):
+    '''
+    Records in filename every request that reaches the solvers until
+    stop_trace(): Equilibrium.set_state() and the set_state() of the
+    performances.  The requests answered by the caches are not
+    recorded.  The trace is run again by the replay program of cpropep
+    to measure the latency of the solvers on a real workload.
+    '''
+    err = lib.trace_open(filename.encode('utf-8'))
+    if err < 0:
+        raise RuntimeError("Opening the trace {} failed with {}".format(
+            filename, RET_ERRORS[err]))
+
+
+def stop_trace():
+    '''
+    Stops the recording and closes the trace.  Returns trace_stats().
+    '''
+    stats = trace_stats()
+    err = lib.trace_close()
+    if err < 0:
+        raise RuntimeError("Closing the trace failed with {}".format(
+            RET_ERRORS[err]))
+    return stats
+
+
+def trace_stats():
+    '''
+    Returns a dict with the number of requests recorded and dropped
+    (too many exit conditions or write error) since start_trace().
+    '''
+    recorded = ffi.new("unsigned long *")
+    dropped = ffi.new("unsigned long *")
+    lib.trace_stats(recorded, dropped)
+    return {'recorded': recorded[0], 'dropped': dropped[0]}
@@ -0,0 +1,113 @@
+import pytest
+
+
+@pytest.fixture
+def pypropep():
+    import pypropep
+    pypropep.init()
+    return pypropep
+
+
+def test_cache(pypropep):
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+    pypropep.enable_cache(2)
+    try:
+        start = pypropep.cache_stats()
+
+        p = pypropep.ShiftingPerformance()
+        p.add_propellants_by_mass([(lh2, 1.0), (lox, 5.551)])
+        p.set_state(P=50., Ae_At=10.)
+        Isp = p.performance.Isp
+        p.set_state(P=50., Ae_At=40.)
+
+        # Same mixture, other order and scale
+        q = pypropep.ShiftingPerformance()
+        q.add_propellants_by_mass([(lox, 11.102), (lh2, 2.0)])
+        q.set_state(P=50., Ae_At=10.)
+        assert q.performance.Isp == pytest.approx(Isp, 1e-12)
+
+        stats = pypropep.cache_stats()
+        assert stats['hits'] - start['hits'] == 2
+        assert stats['misses'] - start['misses'] == 1
+
+        # The chamber is solved again at another pressure
+        q.set_state(P=10., Ae_At=10.)
+        assert q.properties[0].T < p.properties[0].T
+        assert pypropep.cache_stats()['misses'] - start['misses'] == 2
+
+        # Least recently used (P=50) is replaced
+        q.set_state(P=20., Ae_At=10.)
+        p.set_state(P=50., Ae_At=10.)
+        assert pypropep.cache_stats()['misses'] - start['misses'] == 4
+
+        # Reloading the data invalidates the cache
+        pypropep.init()
+        p.set_state(P=50., Ae_At=10.)
+        assert pypropep.cache_stats()['misses'] - start['misses'] == 5
+    finally:
+        pypropep.disable_cache()
+
+
+def test_cache_threads(pypropep):
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+
+    def isp(context, OF):
+        p = context.shifting_performance()
+        p.add_propellants_by_mass([(ch4, 1.0), (o2, OF)])
+        p.set_state(P=50., Pe=1.)
+        return p.performance.Isp
+
+    jobs = [2. + 0.05 * i for i in range(40)]
+    reference = pypropep.parallel_map(isp, jobs, workers=4)
+
+    # fewer entries than mixtures: the threads evict each other
+    pypropep.enable_cache(16)
+    try:
+        start = pypropep.cache_stats()
+        for i in range(3):
+            assert pypropep.parallel_map(isp, jobs, workers=4) == reference
+        stats = pypropep.cache_stats()
+        assert (stats['hits'] + stats['misses'] -
+                start['hits'] - start['misses']) == 3 * len(jobs)
+
+        # the last 16 mixtures are kept
+        start = pypropep.cache_stats()
+        pypropep.parallel_map(isp, jobs[-8:], workers=4)
+        assert pypropep.cache_stats()['hits'] - start['hits'] == 8
+    finally:
+        pypropep.disable_cache()
+
+
+def test_disk_cache(pypropep, tmpdir):
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+    pypropep.open_disk_cache(str(tmpdir.join('cache')))
+    try:
+        start = pypropep.disk_cache_stats()
+
+        p = pypropep.FrozenPerformance()
+        p.add_propellants_by_mass([(lh2, 1.0), (lox, 5.551)])
+        p.set_state_multi(P=50., exit_conditions=[('Pe', 1.), ('Ae_At', 25.)])
+        Isp = [perf.Isp for perf in p.exit_performance]
+        assert len(tmpdir.join('cache').listdir()) == 1
+
+        q = pypropep.FrozenPerformance()
+        q.add_propellants_by_mass([(lox, 11.102), (lh2, 2.0)])
+        q.set_state_multi(P=50., exit_conditions=[('Pe', 1.), ('Ae_At', 25.)])
+        assert [perf.Isp for perf in q.exit_performance] == Isp
+        assert q.properties[0].T == p.properties[0].T
+
+        e = pypropep.Equilibrium()
+        e.add_propellants_by_mass([(lh2, 1.0), (lox, 5.551)])
+        e.set_state(P=50., type='HP')
+        e.set_state(P=50., type='HP')
+        assert e.properties.T == pytest.approx(p.properties[0].T)
+
+        stats = pypropep.disk_cache_stats()
+        assert stats['hits'] - start['hits'] == 2
+        assert stats['misses'] - start['misses'] == 2
+        assert len(tmpdir.join('cache').listdir()) == 2
+    finally:
+        pypropep.close_disk_cache()
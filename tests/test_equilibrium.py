@@ -88,6 +88,33 @@ def test_condensing_equil(pypropep):
     p.add_propellants([(kno3, 0.65/kno3.mw), (sugar, 0.35/sugar.mw)])
     p.set_state(P=30)
     assert len(p.composition_condensed) > 0
+
+def test_composition_views(pypropep):
+    import numpy as np
+    kno3 = pypropep.PROPELLANTS['POTASSIUM NITRATE']
+    sugar = pypropep.PROPELLANTS['SUCROSE (TABLE SUGAR)']
+    p = pypropep.Equilibrium()
+    p.add_propellants([(kno3, 0.65/kno3.mw), (sugar, 0.35/sugar.mw)])
+    p.set_state(P=30)
+
+    # The views share the memory of the solver state
+    moles = p.moles
+    assert moles.base is not None
+    assert len(moles) == len(p.species_ids)
+    x = np.concatenate([p.molar_fractions, p.molar_fractions_condensed])
+    assert x.sum() == pytest.approx(1.0, 1e-9)
+
+    i = int(np.argmax(p.molar_fractions))
+    name, value = p.composition_sorted[0]
+    assert pypropep.SPECIES[name]['id'] == p.species_ids[i]
+    assert value == p.molar_fractions[i]
+
+    T = p.properties.T
+    p.set_state(P=1)
+    assert p.properties.T < T
+    assert p.composition_sorted[0][1] == pytest.approx(
+        p.molar_fractions.max(), 1e-12)
+
 # def test_SP_equil(pypropep):
 #     e = pypropep.Equilibrium()
 #     o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
@@ -99,3 +126,99 @@ def test_condensing_equil(pypropep):
 #     assert e.equilibrated is True
 #     assert e.properties_computed is True
 #     assert e.properties.T < 0.5*T
+
+
+def test_snapshot(pypropep):
+    import pickle
+    from pypropep.cpropep._cpropep import ffi
+    kno3 = pypropep.PROPELLANTS['POTASSIUM NITRATE']
+    sugar = pypropep.PROPELLANTS['SUCROSE (TABLE SUGAR)']
+    p = pypropep.Equilibrium()
+    p.add_propellants([(kno3, 0.65/kno3.mw), (sugar, 0.35/sugar.mw)])
+    p.set_state(P=30)
+
+    snapshot = p.save()
+    assert len(snapshot) < ffi.sizeof("equilibrium_t") / 5
+
+    q = pickle.loads(pickle.dumps(p))
+    assert q.properties.T == p.properties.T
+    assert q.composition == p.composition
+    assert q.composition_condensed == p.composition_condensed
+    assert q.save() == snapshot
+
+    # Warm restart of the restored state
+    p.set_state(P=10)
+    q.set_state(P=10)
+    assert q.properties.T == pytest.approx(p.properties.T, 1e-6)
+
+    with pytest.raises(RuntimeError):
+        q.restore(snapshot[:-1])
+    with pytest.raises(RuntimeError):
+        q.restore(b'XXXX' + snapshot[4:])
+
+
+def test_pool(pypropep):
+    from pypropep.cpropep._cpropep import ffi, lib
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+    fresh = ffi.buffer(ffi.new("equilibrium_t *"))[:]
+
+    # Start from a newly allocated buffer
+    pypropep.trim_pool()
+    with pypropep.Equilibrium() as e:
+        e.add_propellants([(o2, 1.), (ch4, 1.)])
+        e.set_state(P=1.0, type='HP')
+        T = e.properties.T
+    start = pypropep.pool_stats()
+    assert start['free'] > 0
+
+    # The released buffer comes back cleared to its initial state
+    e = pypropep.Equilibrium()
+    assert pypropep.pool_stats()['recycled'] == start['recycled'] + 1
+    lib.clear_equilibrium(e._equil)
+    init = ffi.new("equilibrium_t *")
+    lib.initialize_equilibrium(init)
+    assert ffi.buffer(e._equil)[:] == ffi.buffer(init)[:]
+    assert fresh != ffi.buffer(init)[:]
+
+    e.add_propellants([(o2, 1.), (ch4, 1.)])
+    e.set_state(P=1.0, type='HP')
+    assert e.properties.T == pytest.approx(T, 1e-9)
+    e.release()
+
+    with pypropep.ShiftingPerformance() as p:
+        p.add_propellants_by_mass([(ch4, 1.0), (o2, 3.0)])
+        p.set_state(P=50., Pe=1.)
+    assert p._equil_structs is None
+
+
+def test_solver_stats(pypropep):
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+    al = pypropep.PROPELLANTS['ALUMINUM (PURE CRYSTALINE)']
+
+    e = pypropep.Equilibrium()
+    e.add_propellants([(o2, 2.), (ch4, 1.)])
+    e.set_state(P=10.0, type='HP')
+    stats = e.stats
+    assert stats['iterations'] > 0
+    assert stats['lu'] >= stats['iterations']
+    assert stats['inserted'] == 0
+    assert 0. < stats['lambda'] <= 1.
+    assert stats['time'] > 0.
+
+    # Alumina condenses in the chamber
+    e = pypropep.Equilibrium()
+    e.add_propellants_by_mass([(o2, 3.0), (ch4, 1.0), (al, 1.0)])
+    e.set_state(P=50.0, type='HP')
+    assert e.stats['inserted'] > 0
+    assert e.stats['restarts'] > 0
+    assert e.stats['iterations'] > stats['iterations']
+
+    # Aluminum and water at low temperature go through singular matrices
+    water = pypropep.PROPELLANTS['WATER']
+    e = pypropep.Equilibrium()
+    e.add_propellants_by_mass([(al, 1.0), (water, 1.0)])
+    e.set_state(P=20.0, T=600.0, type='TP')
+    assert e.stats['singular'] > 0
+    assert 'singular' in e.warnings
@@ -0,0 +1,70 @@
+import pytest
+
+
+@pytest.fixture
+def pypropep():
+    import pypropep
+    pypropep.init()
+    return pypropep
+
+
+def test_parallel_map(pypropep):
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+
+    def isp(context, OF):
+        p = context.shifting_performance()
+        p.add_propellants_by_mass([(ch4, 1.0), (o2, OF)])
+        p.set_state(P=50., Pe=1.)
+        return p.performance.Isp
+
+    jobs = [2. + 0.1 * i for i in range(20)] * 2
+    serial = [isp(pypropep.parallel.Context(), OF) for OF in jobs]
+
+    assert pypropep.parallel_map(isp, jobs, workers=4) == serial
+
+    # The chamber cache is shared by the threads
+    pypropep.enable_cache(8)
+    try:
+        assert pypropep.parallel_map(isp, jobs, workers=4) == \
+            pytest.approx(serial, 1e-9)
+    finally:
+        pypropep.disable_cache()
+
+
+def test_timeline(pypropep, tmpdir):
+    import json
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+
+    def isp(context, OF):
+        p = context.shifting_performance()
+        p.add_propellants_by_mass([(ch4, 1.0), (o2, OF)])
+        p.set_state(P=50., Ae_At=10.)
+        return p.performance.Isp
+
+    pypropep.reset_timeline()
+    pypropep.parallel_map(isp, [2. + 0.2 * i for i in range(8)], workers=2)
+    filename = str(tmpdir.join('timeline.json'))
+    stats = pypropep.write_timeline(filename)
+
+    with open(filename) as f:
+        timeline = json.load(f)
+    events = [ev for ev in timeline['traceEvents'] if ev['ph'] != 'M']
+    if not pypropep.timeline_enabled():
+        assert stats['recorded'] == 0
+        assert events == []
+        return
+
+    assert len(events) == stats['recorded'] - stats['dropped']
+    names = set(ev['name'] for ev in events)
+    for name in ('equilibrium', 'newton', 'lu', 'throat', 'exit',
+                 'throat_iteration', 'exit_iteration'):
+        assert name in names
+    for ev in events:
+        assert ev['ts'] >= 0.
+        if ev['ph'] == 'X':
+            assert ev['dur'] >= 0.
+
+    pypropep.reset_timeline()
+    assert pypropep.write_timeline(filename)['recorded'] == 0
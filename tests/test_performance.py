@@ -69,3 +69,307 @@ def test_properties(pypropep):
     assert p.properties[0].Cp == pytest.approx(e.properties.Cp, 1e-2)
     assert p.properties[0].Isex == pytest.approx(e.properties.Isex, 1e-2)
     assert p.properties[0].Cv == pytest.approx(e.properties.Cv, 1e-2)
+
+def test_multi_exit_performance(pypropep):
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+    OF = 5.551
+    exits = [('Ae_At_subsonic', 3.), ('Pe', 1.), ('Ae_At', 10.), ('Ae_At', 25.)]
+    for cls in (pypropep.FrozenPerformance, pypropep.ShiftingPerformance):
+        p = cls()
+        p.add_propellants_by_mass([(lh2, 1.0), (lox, OF)])
+        perf = p.set_state_multi(P=50., exit_conditions=exits)
+        assert len(perf) == len(exits)
+        assert len(p.properties) == len(exits) + 2
+        assert perf[0].ae_at == pytest.approx(3., 1e-3)
+        assert perf[2].ae_at == pytest.approx(10., 1e-3)
+        assert perf[3].Isp > perf[2].Isp > perf[0].Isp
+
+        single = cls()
+        single.add_propellants_by_mass([(lh2, 1.0), (lox, OF)])
+        single.set_state(P=50., Ae_At=25.)
+        assert perf[3].Isp == pytest.approx(single.performance.Isp, 1e-4)
+        assert p.properties[5].T == pytest.approx(single.properties[2].T, 1e-4)
+
+        # Back to a single exit station
+        p.set_state(P=50., Pe=1.)
+        assert len(p.properties) == 3
+        assert p.performance.Isp == pytest.approx(perf[1].Isp, 1e-4)
+
+def test_nozzle_profile(pypropep):
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+    OF = 5.551
+    stations = [('Ae_At_subsonic', a) for a in (4., 2., 1.2)] + \
+               [('Ae_At', a) for a in range(2, 26)]
+    for cls in (pypropep.FrozenPerformance, pypropep.ShiftingPerformance):
+        p = cls()
+        p.add_propellants_by_mass([(lh2, 1.0), (lox, OF)])
+        profile = p.nozzle_profile(P=50., stations=stations)
+        assert len(profile) == len(stations) + 2
+        assert profile['P'][0] == pytest.approx(50.)
+        assert profile['mach'][0] == 0.
+        assert profile['mach'][4] == pytest.approx(1.)
+        assert profile['ae_at'][4] == pytest.approx(1.)
+        assert all(profile['P'][1:] < profile['P'][:-1])
+        assert all(profile['mach'][1:] > profile['mach'][:-1])
+        assert profile['H2O'][-1] > 0.1
+
+        single = cls()
+        single.add_propellants_by_mass([(lh2, 1.0), (lox, OF)])
+        single.set_state(P=50., Ae_At=25.)
+        assert profile['ae_at'][-1] == pytest.approx(25., 1e-4)
+        assert profile['u'][-1] == pytest.approx(single.performance.Isp, 1e-4)
+        assert profile['T'][-1] == pytest.approx(single.properties[2].T, 1e-4)
+
+def test_ambient_performance(pypropep):
+    p = pypropep.ShiftingPerformance()
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+    p.add_propellants_by_mass([(lh2, 1.0), (lox, 5.551)])
+    p.set_state(P=53.317*0.986923, Ae_At=25.)
+    perf = p.performance
+
+    amb = p.ambient_performance(Pa=[0., p.properties[2].P, 1.])
+    assert amb['Isp'][0] == pytest.approx(perf.Ivac)
+    assert amb['Isp'][1] == pytest.approx(perf.Isp)
+    assert amb['cf'][1] == pytest.approx(perf.cf)
+    assert list(amb['separated']) == [False, False, True]
+
+    alt = p.ambient_performance(altitude=[0., 11000., 20000., 100000.])
+    assert alt['Pa'] == pytest.approx([1., 0.224030, 0.054570, 0.], 1e-4)
+    assert alt['Isp'][-1] == pytest.approx(perf.Ivac)
+    assert all(alt['Isp'][1:] > alt['Isp'][:-1])
+
+    for station in (-1, 1):
+        with pytest.raises(ValueError):
+            p.ambient_performance(Pa=[1.], station=station)
+
+
+def test_performance_pickle(pypropep):
+    import pickle
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+    p = pypropep.ShiftingPerformance()
+    p.add_propellants_by_mass([(ch4, 1.0), (o2, 3.0)])
+    p.set_state(P=50., Pe=1.)
+
+    q = pickle.loads(pickle.dumps(p))
+    assert q.performance.Isp == p.performance.Isp
+    assert q.composition == p.composition
+
+    p.set_state(P=20., Ae_At=10.)
+    q.set_state(P=20., Ae_At=10.)
+    assert q.performance.Isp == pytest.approx(p.performance.Isp, 1e-6)
+
+
+def test_timing_stats(pypropep):
+    if not pypropep.timing_enabled():
+        pytest.skip("timers not compiled")
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+
+    pypropep.reset_timing()
+    p = pypropep.ShiftingPerformance()
+    p.add_propellants_by_mass([(ch4, 1.0), (o2, 3.0)])
+    p.set_state(P=50., Pe=1.)
+
+    stats = pypropep.timing_stats()
+    for phase in ('list', 'chamber', 'throat', 'exit', 'derivative'):
+        assert stats[phase]['count'] > 0
+        assert stats[phase]['total'] > 0.
+    assert stats['load']['count'] == 0
+    assert stats['derivative']['count'] >= 3
+    assert stats['exit']['max'] <= stats['exit']['total']
+    assert 'throat' in repr(stats)
+
+    pypropep.reset_timing()
+    assert pypropep.timing_stats()['chamber']['count'] == 0
+
+    # each thread has its own statistics, summed once the threads ended
+    def isp(context, OF):
+        q = context.shifting_performance()
+        q.add_propellants_by_mass([(ch4, 1.0), (o2, OF)])
+        q.set_state(P=50., Pe=1.)
+        return q.performance.Isp
+
+    pypropep.parallel_map(isp, [2.5, 3.0, 3.5, 4.0] * 2, workers=4)
+    stats = pypropep.timing_stats()
+    assert stats['throat']['count'] == 8
+    assert stats['exit']['count'] == 8
+
+
+def test_solver_stats(pypropep):
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+
+    p = pypropep.ShiftingPerformance()
+    p.add_propellants_by_mass([(ch4, 1.0), (o2, 3.0)])
+    p.set_state(P=50., Ae_At=20.)
+    stats = p.stats
+    assert len(stats) == 3
+    for s in stats:
+        assert s['iterations'] > 0
+        assert s['time'] > 0.
+    # the exit pressure search solves several equilibria, each one
+    # followed by the two LU solves of the derivatives
+    assert stats[2]['lu'] > stats[2]['iterations'] + 2
+
+    # no equilibrium is solved at the frozen stations
+    p = pypropep.FrozenPerformance()
+    p.add_propellants_by_mass([(ch4, 1.0), (o2, 3.0)])
+    p.set_state(P=50., Pe=1.)
+    assert p.stats[0]['iterations'] > 0
+    assert p.stats[1]['iterations'] == 0
+    assert p.stats[2]['iterations'] == 0
+
+
+def test_trace(pypropep, tmpdir):
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    ch4 = pypropep.PROPELLANTS['METHANE']
+    filename = str(tmpdir.join('requests.trace'))
+
+    pypropep.start_trace(filename)
+    e = pypropep.Equilibrium()
+    e.add_propellants_by_mass([(ch4, 1.0), (o2, 3.0)])
+    e.set_state(P=50., type='HP')
+    p = pypropep.ShiftingPerformance()
+    p.add_propellants_by_mass([(ch4, 1.0), (o2, 3.0)])
+    p.set_state(P=50., Pe=1.)
+    stats = pypropep.stop_trace()
+
+    # the equilibria solved by the performance are not recorded
+    assert stats == {'recorded': 2, 'dropped': 0}
+    with open(filename, 'rb') as f:
+        assert f.read(8) == b'CPTRACE1'
+
+    # nothing is recorded once the trace is closed
+    e.set_state(P=20., type='HP')
+    assert pypropep.trace_stats()['recorded'] == 2
+
+
+def test_diagnostics(pypropep):
+    htpb = pypropep.PROPELLANTS['HTPB (SINCLAIR)']
+    ap = pypropep.PROPELLANTS['AMMONIUM PERCHLORATE (AP)']
+    al = pypropep.PROPELLANTS['ALUMINUM (PURE CRYSTALINE)']
+    composition = [(htpb, 12.), (ap, 70.), (al, 18.)]
+
+    # the exit of this aluminized propellant has a singular matrix of
+    # derivatives, each exit equilibrium raises it
+    with pypropep.Diagnostics(limit=2, case_id=7) as d:
+        p = pypropep.ShiftingPerformance()
+        p.add_propellants_by_mass(composition)
+        p.set_state(P=68., Ae_At=10.)
+    assert p.warnings[0] == []
+    assert 'derivative' in p.warnings[2]
+    assert p.stats[2]['warnings'] != 0
+
+    assert d.counts['derivative'] > 2
+    assert len(d.messages) == 2
+    assert d.messages[0]['case'] == 7
+    assert d.messages[0]['severity'] == 'warning'
+    assert d.messages[0]['code'] == 'derivative'
+
+    # detached, the results still carry the warnings
+    q = pypropep.ShiftingPerformance()
+    q.add_propellants_by_mass(composition)
+    q.set_state(P=68., Ae_At=10.)
+    assert q.warnings == p.warnings
+    assert len(d.messages) == 2
+    d.clear()
+    assert d.counts == {}
+
+
+def test_budget(pypropep):
+    htpb = pypropep.PROPELLANTS['HTPB (SINCLAIR)']
+    ap = pypropep.PROPELLANTS['AMMONIUM PERCHLORATE (AP)']
+    al = pypropep.PROPELLANTS['ALUMINUM (PURE CRYSTALINE)']
+    composition = [(htpb, 12.), (ap, 70.), (al, 18.)]
+
+    p = pypropep.ShiftingPerformance()
+    p.add_propellants_by_mass(composition)
+    p.set_state(P=68., Ae_At=10.)
+    iterations = sum(s['iterations'] for s in p.stats)
+
+    # a budget that is not reached does not change the results
+    with pypropep.Budget(iterations=iterations, timeout=60.) as b:
+        q = pypropep.ShiftingPerformance()
+        q.add_propellants_by_mass(composition)
+        q.set_state(P=68., Ae_At=10.)
+    assert not b.exhausted
+    assert b.iterations == iterations
+    assert q.performance.Isp == p.performance.Isp
+
+    # the solver stops in the nozzle with the state it reached
+    with pypropep.Budget(iterations=iterations // 2) as b:
+        r = pypropep.ShiftingPerformance()
+        r.add_propellants_by_mass(composition)
+        with pytest.raises(pypropep.BudgetExhausted):
+            r.set_state(P=68., Ae_At=10.)
+    assert b.exhausted
+    assert b.iterations == iterations // 2 + 1
+    assert 'budget' in sum(r.warnings, [])
+    assert r.properties[0].T == p.properties[0].T
+
+    # a spent budget stops the next solves at once
+    with b:
+        with pytest.raises(pypropep.BudgetExhausted):
+            r.set_state(P=68., Ae_At=10.)
+    assert b.iterations == iterations // 2 + 2
+
+
+def test_throat_residual(pypropep):
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+
+    for cls in (pypropep.FrozenPerformance, pypropep.ShiftingPerformance):
+        p = cls()
+        p.add_propellants_by_mass([(lh2, 1.0), (lox, 5.5)])
+        perf = p.set_state_multi(P=68., exit_conditions=[('Ae_At', 10.),
+                                                         ('Pe', 1.)])
+        # the throat is the last state of the iteration
+        throat = p.throat_performance
+        assert 0. < throat.residual < 0.4e-4
+        assert throat.Isp == p.properties[1].Vson
+        assert throat.ae_at == 1.
+        assert perf[0].residual < 0.4e-4
+        assert perf[1].residual == 0.
+
+
+def test_exit_iteration(pypropep):
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+
+    for cls in (pypropep.FrozenPerformance, pypropep.ShiftingPerformance):
+        p = cls()
+        p.add_propellants_by_mass([(lh2, 1.0), (lox, 5.5)])
+        perf = p.set_state_multi(P=68., exit_conditions=[
+            ('Ae_At_subsonic', 2.), ('Ae_At', 1.01), ('Ae_At', 10.),
+            ('Ae_At', 11.), ('Pe', 1.)])
+        for s, ae_at in zip(perf, (2., 1.01, 10., 11.)):
+            assert s.ae_at == pytest.approx(ae_at, 1e-5)
+            assert 0 < s.iterations <= 6
+        assert p.throat_performance.iterations > 0
+        assert perf[4].iterations == 1
+
+        # the station next to the previous one start from it
+        p.set_state(P=68., Ae_At=11.)
+        assert perf[3].iterations < p.performance.iterations
+
+
+def test_subsonic_exit_warnings(pypropep):
+    fuels = [('HYDROGEN (CRYOGENIC)', 'OXYGEN (LIQUID)', 5.5),
+             ('RP-1 (RPL)', 'OXYGEN (LIQUID)', 2.6),
+             ('METHANE', 'OXYGEN (LIQUID)', 3.4)]
+    exits = [('Ae_At_subsonic', a) for a in (5., 3., 2., 1.2)]
+
+    for fuel, ox, ratio in fuels:
+        for cls in (pypropep.FrozenPerformance,
+                    pypropep.ShiftingPerformance):
+            p = cls()
+            p.add_propellants_by_mass([(pypropep.PROPELLANTS[fuel], 1.0),
+                                       (pypropep.PROPELLANTS[ox], ratio)])
+            perf = p.set_state_multi(P=50., exit_conditions=exits)
+            for s, w in zip(perf, p.warnings[2:]):
+                assert 'exit' not in w
+                assert s.residual < 1e-3
@@ -29,3 +29,27 @@ def test_thermo_file_override(pypropep):
 def test_find_propellant(pypropep):
     assert len(pypropep.find_propellant('oxygen')) > 1
     assert len(pypropep.find_propellant('OXYGEN')) > 1
+
+
+def test_lazy_tables(pypropep):
+    from pypropep.cpropep._cpropep import ffi, lib
+    assert len(list(pypropep.SPECIES)) == len(pypropep.SPECIES)
+
+    # Repeated names get one ' per previous entry of the same name
+    keys = list(pypropep.SPECIES)
+    assert "Cr2O3(I)''" in keys
+    ids = [pypropep.SPECIES[k]['id'] for k in
+           ['Cr2O3(I)', "Cr2O3(I)'", "Cr2O3(I)''"]]
+    assert ids == sorted(ids)
+    for i in ids:
+        assert ffi.string(lib.thermo_list[i].name) == b'Cr2O3(I)'
+    assert "Cr2O3(I)'''" not in pypropep.SPECIES
+
+    for i, k in enumerate(keys[::97]):
+        assert pypropep.SPECIES[k]['id'] == 97 * i
+
+    o2 = pypropep.PROPELLANTS['OXYGEN (GAS)']
+    assert o2 is pypropep.PROPELLANTS['OXYGEN (GAS)']
+    assert o2.formula() == 'O2'
+    with pytest.raises(KeyError):
+        pypropep.PROPELLANTS['NOT A PROPELLANT']
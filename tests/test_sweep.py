@@ -0,0 +1,41 @@
+import pytest
+import numpy as np
+
+
+@pytest.fixture
+def pypropep():
+    import pypropep
+    pypropep.init()
+    return pypropep
+
+
+def test_sweep(pypropep):
+    lh2 = pypropep.PROPELLANTS['HYDROGEN (CRYOGENIC)']
+    lox = pypropep.PROPELLANTS['OXYGEN (LIQUID)']
+
+    OF = np.array([4., 5.551, 7.])
+    P = np.array([[20.], [50.]])
+    r = pypropep.sweep([(lh2, 1.)], [(lox, 1.)], OF=OF, P=P, Ae_At=40.)
+    assert r.shape == (2, 3)
+    assert np.all(r['OF'] == OF)
+    assert np.all(r['chamber_P'] == P)
+    assert np.all(r['ae_at'] == pytest.approx(40.))
+    assert np.all(r['H2O'] > 0.)
+
+    # Same point through the per-case API
+    p = pypropep.ShiftingPerformance()
+    p.add_propellants_by_mass([(lh2, 1.0), (lox, 5.551)])
+    p.set_state(P=50., Ae_At=40.)
+    assert r['Isp'][1, 1] == pytest.approx(p.performance.Isp, 1e-6)
+    assert r['chamber_T'][1, 1] == pytest.approx(p.properties[0].T, 1e-6)
+    assert r['exit_P'][1, 1] == pytest.approx(p.properties[2].P, 1e-6)
+    assert r['H2O'][1, 1] == pytest.approx(
+        dict(p.composition['exit'])['H2O'], 1e-5)
+
+    # Frozen and shifting in the same order as the per-case API
+    f = pypropep.sweep([(lh2, 1.)], [(lox, 1.)], OF=5.551, P=50., Pe=1.,
+                       frozen=True)
+    s = pypropep.sweep([(lh2, 1.)], [(lox, 1.)], OF=5.551, P=50., Pe=1.)
+    assert f.shape == ()
+    assert f['exit_P'] == pytest.approx(1.)
+    assert f['Isp'] < s['Isp']